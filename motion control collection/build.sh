@@ -150,7 +150,7 @@ fi
 cd make
 
 echo "Running CMake..."
-cmake ..
+cmake -DCMAKE_BUILD_TYPE=Release ..
 
 echo "Compiling..."
 make -j$(nproc)
@@ -164,6 +164,34 @@ else
     echo "[OK] output directory exists"
 fi
 cp make/motion_control output/
+cp make/motion_bench output/
+cp make/pack_assets output/
+cp make/analyze_beats output/
+cp make/shrink_model output/
+cp make/calibrate_pose output/
+
+FP16_WEIGHTS_FILE="models/pose_iter_440000_fp16.caffemodel"
+if [ -f "$WEIGHTS_FILE" ] && [ ! -f "$FP16_WEIGHTS_FILE" ]; then
+    echo "Converting OpenPose weights to FP16..."
+    ./output/shrink_model "$WEIGHTS_FILE" "$FP16_WEIGHTS_FILE" || echo "[WARNING] Model conversion failed - the original weights will be loaded"
+fi
+
+echo "Analyzing song beats..."
+if [ -f "audio and sound effects/rhythm_dance.mp3" ]; then
+    ./output/analyze_beats "audio and sound effects/rhythm_dance.mp3" || echo "[WARNING] Beat analysis failed - Rhythm Dance will use a fixed tempo"
+else
+    echo "[INFO] No Rhythm Dance track to analyze"
+fi
+
+echo "Packing assets..."
+shopt -s nullglob
+AUDIO_FILES=("audio and sound effects"/*.mp3 "audio and sound effects"/*.wav "audio and sound effects"/*.ogg)
+shopt -u nullglob
+if [ ${#AUDIO_FILES[@]} -gt 0 ]; then
+    ./output/pack_assets assets.pack "${AUDIO_FILES[@]}"
+else
+    echo "[INFO] No audio files to pack"
+fi
 
 echo ""
 echo "=========================================="
@@ -1,4 +1,8 @@
 #include "archery_game.h"
+#include "session.h"
+#include "asset_pack.h"
+#include "audio_engine.h"
+#include "particles.h"
 
 struct Arrow {
     float x, y;
@@ -14,116 +18,102 @@ struct ArcheryTarget {
     int rings[5] = {60, 48, 36, 24, 12};
 };
 
-void runArchery(SDL_Renderer* renderer, PoseDetector& poseDetector, cv::VideoCapture& cap,
-                bool useCamera, cv::Mat& currentFrame, bool& returnToMenu, Mix_Music* menuMusic) {
-    Mix_Music* archeryMusic = Mix_LoadMUS("audio and sound effects/archery_background.mp3");
-    Mix_Chunk* arrowSound = Mix_LoadWAV("audio and sound effects/arrow_shoot.mp3");
-    
-    if (menuMusic) {
-        Mix_HaltMusic();
-    }
-    
-    if (archeryMusic) {
-        Mix_PlayMusic(archeryMusic, -1);
-        Mix_VolumeMusic(MIX_MAX_VOLUME / 3);
-    }
-    
+struct ArcheryState {
     Arrow arrow;
     ArcheryTarget target;
     int score = 0;
     int arrowsLeft = 10;
-    bool running = true;
-    
-    target.x = GAME_WIDTH - 150;
-    target.y = GAME_HEIGHT / 2.0f;
-    
     float aimY = GAME_HEIGHT / 2.0f;
     float drawAmount = 0;
     bool isDrawing = false;
-    float prevArmY = 0.5f;
-
-    while (running && !returnToMenu) {
-        SDL_Event event;
-        while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_QUIT) { running = false; returnToMenu = false; }
-            else if (event.type == SDL_KEYDOWN) {
-                if (event.key.keysym.sym == SDLK_ESCAPE) returnToMenu = true;
-                if (event.key.keysym.sym == SDLK_q) returnToMenu = true;
-                if (event.key.keysym.sym == SDLK_SPACE && !arrow.flying && arrowsLeft > 0) {
-                    isDrawing = true;
-                }
-            }
-            else if (event.type == SDL_KEYUP) {
-                if (event.key.keysym.sym == SDLK_SPACE && isDrawing && !arrow.flying) {
-                    arrow.x = 100;
-                    arrow.y = aimY;
-                    arrow.speedX = drawAmount * 20;
-                    arrow.speedY = 0;
-                    arrow.flying = true;
-                    arrowsLeft--;
-                    isDrawing = false;
-                    drawAmount = 0;
-                    if (arrowSound) {
-                        Mix_PlayChannel(-1, arrowSound, 0);
-                    }
-                }
+    ParticleSystem particles;
+};
+
+class ArcheryGame : public Game {
+public:
+    explicit ArcheryGame(Mix_Music* menuMusic) : menuMusic(menuMusic), state(initialState()) {}
+
+    void onEnter() override {
+        Mix_Music* archeryMusic = audioAssetMusic("audio and sound effects/archery_background.mp3");
+        if (menuMusic) {
+            Mix_HaltMusic();
+        }
+        if (archeryMusic) {
+            Mix_PlayMusic(archeryMusic, -1);
+            Mix_VolumeMusic(MIX_MAX_VOLUME / 3);
+        }
+    }
+
+    void onExit() override {
+        Mix_HaltMusic();
+        if (menuMusic) {
+            Mix_PlayMusic(menuMusic, -1);
+            Mix_VolumeMusic(MIX_MAX_VOLUME / 3);
+        }
+    }
+
+    void update(float dt, const GameInput& input) override {
+        ArcheryState& s = state.back();
+        Arrow& arrow = s.arrow;
+        s.particles.update(dt);
+        for (const SDL_Event& event : input.events) {
+            if (event.key.keysym.sym != SDLK_SPACE) continue;
+            if (event.type == SDL_KEYDOWN && !arrow.flying && s.arrowsLeft > 0) {
+                s.isDrawing = true;
+            } else if (event.type == SDL_KEYUP && s.isDrawing && !arrow.flying) {
+                fireArrow(s);
             }
         }
 
-        if (useCamera && cap.read(currentFrame)) {
-            cv::flip(currentFrame, currentFrame, 1);
-            float armY = poseDetector.detectArmPosition(currentFrame);
-            aimY = armY * GAME_HEIGHT;
-            
-            float armDelta = std::abs(armY - prevArmY);
-            if (armDelta > 0.02f && !arrow.flying) {
-                isDrawing = true;
-                drawAmount = std::min(1.0f, drawAmount + armDelta * 2);
-            } else if (isDrawing && drawAmount > 0.3f && armDelta < 0.01f && !arrow.flying && arrowsLeft > 0) {
-                arrow.x = 100;
-                arrow.y = aimY;
-                arrow.speedX = drawAmount * 20;
-                arrow.speedY = 0;
-                arrow.flying = true;
-                arrowsLeft--;
-                isDrawing = false;
-                drawAmount = 0;
-                if (arrowSound) {
-                    Mix_PlayChannel(-1, arrowSound, 0);
-                }
+        for (const GestureEvent& gesture : input.pose.gestures) {
+            if (gesture.type == GESTURE_DRAW_START) {
+                if (!arrow.flying && s.arrowsLeft > 0) s.isDrawing = true;
+            } else if (gesture.type == GESTURE_RELEASE && s.isDrawing && !arrow.flying) {
+                s.drawAmount = gesture.amount;
+                fireArrow(s);
             }
-            prevArmY = armY;
+        }
+
+        if (input.pose.detected) {
+            s.aimY = (input.pose.leftHandY + input.pose.rightHandY) / 2 * GAME_HEIGHT;
+            if (s.isDrawing) s.drawAmount = std::max(s.drawAmount, input.pose.drawAmount);
         } else {
-            const Uint8* keys = SDL_GetKeyboardState(NULL);
-            if (keys[SDL_SCANCODE_W] || keys[SDL_SCANCODE_UP]) aimY -= 5;
-            if (keys[SDL_SCANCODE_S] || keys[SDL_SCANCODE_DOWN]) aimY += 5;
-            if (isDrawing) drawAmount = std::min(1.0f, drawAmount + 0.02f);
+            if (input.keys[SDL_SCANCODE_W] || input.keys[SDL_SCANCODE_UP]) s.aimY -= 5;
+            if (input.keys[SDL_SCANCODE_S] || input.keys[SDL_SCANCODE_DOWN]) s.aimY += 5;
+            if (s.isDrawing) s.drawAmount = std::min(1.0f, s.drawAmount + 0.02f);
         }
-        aimY = std::max(50.0f, std::min((float)GAME_HEIGHT - 50, aimY));
+        s.aimY = std::max(50.0f, std::min((float)GAME_HEIGHT - 50, s.aimY));
 
         if (arrow.flying) {
             arrow.x += arrow.speedX;
             arrow.speedY += 0.3f;
             arrow.y += arrow.speedY;
 
-            float dx = arrow.x - target.x;
-            float dy = arrow.y - target.y;
+            float dx = arrow.x - s.target.x;
+            float dy = arrow.y - s.target.y;
             float dist = std::sqrt(dx*dx + dy*dy);
-            
-            if (dist < target.rings[0]) {
+
+            if (dist < s.target.rings[0]) {
                 arrow.flying = false;
-                if (dist < target.rings[4]) score += 100;
-                else if (dist < target.rings[3]) score += 80;
-                else if (dist < target.rings[2]) score += 60;
-                else if (dist < target.rings[1]) score += 40;
-                else score += 20;
+                sfxPlay(SFX_HIT);
+                int points = 20;
+                if (dist < s.target.rings[4]) points = 100;
+                else if (dist < s.target.rings[3]) points = 80;
+                else if (dist < s.target.rings[2]) points = 60;
+                else if (dist < s.target.rings[1]) points = 40;
+                s.score += points;
+                s.particles.burst(arrow.x, arrow.y, PARTICLES_IMPACT, points / 50.0f);
             }
-            
+
             if (arrow.x > GAME_WIDTH || arrow.y > GAME_HEIGHT || arrow.y < 0) {
                 arrow.flying = false;
             }
         }
+    }
 
+    void render(SDL_Renderer* renderer) override {
+        const ArcheryState& s = state.front();
+        const Arrow& arrow = s.arrow;
         SDL_SetRenderDrawColor(renderer, 135, 206, 235, 255);
         SDL_Rect sky = {0, 0, GAME_WIDTH, GAME_HEIGHT};
         SDL_RenderFillRect(renderer, &sky);
@@ -135,19 +125,19 @@ void runArchery(SDL_Renderer* renderer, PoseDetector& poseDetector, cv::VideoCap
         Color ringColors[] = {WHITE, BLACK, BLUE, RED, YELLOW};
         for (int i = 0; i < 5; i++) {
             SDL_SetRenderDrawColor(renderer, ringColors[i].r, ringColors[i].g, ringColors[i].b, 255);
-            drawFilledCircle(renderer, (int)target.x, (int)target.y, target.rings[i]);
+            drawFilledCircle(renderer, (int)s.target.x, (int)s.target.y, s.target.rings[i]);
         }
 
         if (!arrow.flying) {
             SDL_SetRenderDrawColor(renderer, 139, 69, 19, 255);
-            SDL_Rect bow = {70, (int)aimY - 50, 10, 100};
+            SDL_Rect bow = {70, (int)s.aimY - 50, 10, 100};
             SDL_RenderFillRect(renderer, &bow);
 
-            if (isDrawing) {
-                int pullBack = (int)(drawAmount * 50);
+            if (s.isDrawing) {
+                int pullBack = (int)(s.drawAmount * 50);
                 SDL_SetRenderDrawColor(renderer, 200, 200, 200, 255);
-                SDL_RenderDrawLine(renderer, 75, (int)aimY - 50, 100 - pullBack, (int)aimY);
-                SDL_RenderDrawLine(renderer, 75, (int)aimY + 50, 100 - pullBack, (int)aimY);
+                SDL_RenderDrawLine(renderer, 75, (int)s.aimY - 50, 100 - pullBack, (int)s.aimY);
+                SDL_RenderDrawLine(renderer, 75, (int)s.aimY + 50, 100 - pullBack, (int)s.aimY);
             }
         }
 
@@ -162,21 +152,39 @@ void runArchery(SDL_Renderer* renderer, PoseDetector& poseDetector, cv::VideoCap
             drawFilledCircle(renderer, (int)arrow.x, (int)arrow.y, 4);
         }
 
+        s.particles.draw(renderer);
+
         SDL_SetRenderDrawColor(renderer, WHITE.r, WHITE.g, WHITE.b, WHITE.a);
-        drawNumber(renderer, score, 20, 20, 30);
-        drawNumber(renderer, arrowsLeft, GAME_WIDTH - 100, 20, 25);
+        drawNumber(renderer, s.score, 20, 20, 30);
+        drawNumber(renderer, s.arrowsLeft, GAME_WIDTH - 100, 20, 25);
+    }
+
+    void publish() override { state.publish(); }
+
+private:
+    Mix_Music* menuMusic;
+    DoubleBuffer<ArcheryState> state;
 
-        drawCameraFeed(renderer, currentFrame, useCamera);
-        SDL_RenderPresent(renderer);
-        SDL_Delay(16);
+    static ArcheryState initialState() {
+        ArcheryState s;
+        s.target.x = GAME_WIDTH - 150;
+        s.target.y = GAME_HEIGHT / 2.0f;
+        return s;
     }
-    
-    Mix_HaltMusic();
-    if (archeryMusic) Mix_FreeMusic(archeryMusic);
-    if (arrowSound) Mix_FreeChunk(arrowSound);
-    
-    if (menuMusic) {
-        Mix_PlayMusic(menuMusic, -1);
-        Mix_VolumeMusic(MIX_MAX_VOLUME / 3);
+
+    static void fireArrow(ArcheryState& s) {
+        s.arrow.x = 100;
+        s.arrow.y = s.aimY;
+        s.arrow.speedX = s.drawAmount * 20;
+        s.arrow.speedY = 0;
+        s.arrow.flying = true;
+        s.arrowsLeft--;
+        s.isDrawing = false;
+        s.drawAmount = 0;
+        sfxPlay(SFX_ARROW_SHOT);
     }
+};
+
+std::unique_ptr<Game> createArchery(Mix_Music* menuMusic) {
+    return std::make_unique<ArcheryGame>(menuMusic);
 }
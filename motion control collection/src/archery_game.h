@@ -1,9 +1,8 @@
 #ifndef ARCHERY_GAME_H
 #define ARCHERY_GAME_H
 
-#include "common.h"
+#include "game.h"
 
-void runArchery(SDL_Renderer* renderer, PoseDetector& poseDetector, cv::VideoCapture& cap,
-                bool useCamera, cv::Mat& currentFrame, bool& returnToMenu, Mix_Music* menuMusic);
+std::unique_ptr<Game> createArchery(Mix_Music* menuMusic);
 
 #endif
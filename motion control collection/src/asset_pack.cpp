@@ -0,0 +1,247 @@
+#include "asset_pack.h"
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char ASSET_PACK_MAGIC[4] = {'M', 'C', 'P', 'K'};
+
+struct PackEntry {
+    Uint64 offset;
+    Uint64 size;
+};
+
+static const Uint8* packData = nullptr;
+static size_t packSize = 0;
+static std::map<std::string, PackEntry> packEntries;
+
+enum AudioKind { AUDIO_MUSIC, AUDIO_CHUNK };
+
+struct AudioAsset {
+    const char* name;
+    AudioKind kind;
+    bool loaded;
+    Mix_Music* music;
+    Mix_Chunk* chunk;
+};
+
+static AudioAsset audioAssets[] = {
+    {"audio and sound effects/background.mp3", AUDIO_MUSIC, false, nullptr, nullptr},
+    {"audio and sound effects/arrow_shoot.mp3", AUDIO_CHUNK, false, nullptr, nullptr},
+    {"audio and sound effects/boxing_background.mp3", AUDIO_MUSIC, false, nullptr, nullptr},
+    {"audio and sound effects/archery_background.mp3", AUDIO_MUSIC, false, nullptr, nullptr},
+    {"audio and sound effects/rhythm_dance.mp3", AUDIO_MUSIC, false, nullptr, nullptr},
+};
+static const int NUM_AUDIO_ASSETS = sizeof(audioAssets) / sizeof(audioAssets[0]);
+
+static std::thread loaderThread;
+static std::mutex loaderMutex;
+static std::condition_variable loaderCv;
+
+static void putU32(std::vector<Uint8>& out, Uint32 v) {
+    for (int i = 0; i < 4; i++) out.push_back((Uint8)(v >> (8 * i)));
+}
+
+static void putU64(std::vector<Uint8>& out, Uint64 v) {
+    for (int i = 0; i < 8; i++) out.push_back((Uint8)(v >> (8 * i)));
+}
+
+static Uint64 readLE(const Uint8* p, int bytes) {
+    Uint64 v = 0;
+    for (int i = 0; i < bytes; i++) v |= (Uint64)p[i] << (8 * i);
+    return v;
+}
+
+static Uint64 alignUp(Uint64 v) {
+    return (v + ASSET_PACK_ALIGN - 1) / ASSET_PACK_ALIGN * ASSET_PACK_ALIGN;
+}
+
+bool assetPackWrite(const std::string& path, const std::vector<std::string>& files) {
+    std::vector<std::vector<char>> contents;
+    for (const std::string& file : files) {
+        std::ifstream in(file, std::ios::binary);
+        if (!in.good()) {
+            std::cerr << "Could not read asset: " << file << std::endl;
+            return false;
+        }
+        contents.emplace_back(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    Uint64 tableSize = 12;
+    for (const std::string& file : files) tableSize += 4 + file.size() + 16;
+
+    std::vector<Uint8> header(ASSET_PACK_MAGIC, ASSET_PACK_MAGIC + 4);
+    putU32(header, ASSET_PACK_VERSION);
+    putU32(header, (Uint32)files.size());
+    Uint64 offset = alignUp(tableSize);
+    std::vector<Uint64> offsets;
+    for (size_t i = 0; i < files.size(); i++) {
+        putU32(header, (Uint32)files[i].size());
+        header.insert(header.end(), files[i].begin(), files[i].end());
+        putU64(header, offset);
+        putU64(header, contents[i].size());
+        offsets.push_back(offset);
+        offset = alignUp(offset + contents[i].size());
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out.good()) {
+        std::cerr << "Could not write asset pack: " << path << std::endl;
+        return false;
+    }
+    out.write((const char*)header.data(), header.size());
+    Uint64 written = header.size();
+    const char padding[ASSET_PACK_ALIGN] = {};
+    for (size_t i = 0; i < files.size(); i++) {
+        out.write(padding, offsets[i] - written);
+        out.write(contents[i].data(), contents[i].size());
+        written = offsets[i] + contents[i].size();
+    }
+    std::cout << "Packed " << files.size() << " assets into " << path << " (" << written << " bytes)" << std::endl;
+    return out.good();
+}
+
+bool assetPackOpen(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 12) {
+        close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Could not map asset pack: " << path << std::endl;
+        return false;
+    }
+    packData = (const Uint8*)mapped;
+    packSize = st.st_size;
+
+    if (std::memcmp(packData, ASSET_PACK_MAGIC, 4) != 0 || readLE(packData + 4, 4) != ASSET_PACK_VERSION) {
+        std::cerr << "Unsupported asset pack: " << path << std::endl;
+        assetPackClose();
+        return false;
+    }
+
+    Uint32 count = (Uint32)readLE(packData + 8, 4);
+    size_t pos = 12;
+    for (Uint32 i = 0; i < count; i++) {
+        if (pos + 4 > packSize) break;
+        Uint32 nameLen = (Uint32)readLE(packData + pos, 4);
+        pos += 4;
+        if (pos + nameLen + 16 > packSize) break;
+        std::string name((const char*)packData + pos, nameLen);
+        pos += nameLen;
+        PackEntry entry = {readLE(packData + pos, 8), readLE(packData + pos + 8, 8)};
+        pos += 16;
+        if (entry.offset + entry.size > packSize) break;
+        packEntries[name] = entry;
+    }
+    if (packEntries.size() != count) {
+        std::cerr << "Asset pack is truncated: " << path << std::endl;
+        assetPackClose();
+        return false;
+    }
+
+    std::cout << "Asset pack " << path << ": " << count << " assets" << std::endl;
+    return true;
+}
+
+void assetPackClose() {
+    if (packData) munmap((void*)packData, packSize);
+    packData = nullptr;
+    packSize = 0;
+    packEntries.clear();
+}
+
+bool assetPackFind(const std::string& name, const Uint8*& data, size_t& size) {
+    auto it = packEntries.find(name);
+    if (it == packEntries.end()) return false;
+    data = packData + it->second.offset;
+    size = (size_t)it->second.size;
+    return true;
+}
+
+static void loadAudioAsset(AudioAsset& asset) {
+    const Uint8* data;
+    size_t size;
+    Mix_Music* music = nullptr;
+    Mix_Chunk* chunk = nullptr;
+    bool present = true;
+    if (assetPackFind(asset.name, data, size)) {
+        SDL_RWops* rw = SDL_RWFromConstMem(data, (int)size);
+        if (asset.kind == AUDIO_MUSIC) {
+            music = Mix_LoadMUS_RW(rw, 1);
+        } else {
+            chunk = Mix_LoadWAV_RW(rw, 1);
+        }
+    } else if (std::ifstream(asset.name).good()) {
+        if (asset.kind == AUDIO_MUSIC) {
+            music = Mix_LoadMUS(asset.name);
+        } else {
+            chunk = Mix_LoadWAV(asset.name);
+        }
+    } else {
+        present = false;
+    }
+    if (present && !music && !chunk) {
+        std::cerr << "Could not load " << asset.name << ": " << Mix_GetError() << std::endl;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(loaderMutex);
+        asset.music = music;
+        asset.chunk = chunk;
+        asset.loaded = true;
+    }
+    loaderCv.notify_all();
+}
+
+void audioAssetsLoadAsync() {
+    loaderThread = std::thread([] {
+        for (int i = 0; i < NUM_AUDIO_ASSETS; i++) {
+            loadAudioAsset(audioAssets[i]);
+        }
+    });
+}
+
+static AudioAsset* waitForAudioAsset(const char* name) {
+    for (int i = 0; i < NUM_AUDIO_ASSETS; i++) {
+        if (std::strcmp(audioAssets[i].name, name) != 0) continue;
+        std::unique_lock<std::mutex> lock(loaderMutex);
+        if (!loaderThread.joinable() && !audioAssets[i].loaded) return nullptr;
+        loaderCv.wait(lock, [i] { return audioAssets[i].loaded; });
+        return &audioAssets[i];
+    }
+    std::cerr << "Unknown audio asset: " << name << std::endl;
+    return nullptr;
+}
+
+Mix_Music* audioAssetMusic(const char* name) {
+    AudioAsset* asset = waitForAudioAsset(name);
+    return asset ? asset->music : nullptr;
+}
+
+Mix_Chunk* audioAssetChunk(const char* name) {
+    AudioAsset* asset = waitForAudioAsset(name);
+    return asset ? asset->chunk : nullptr;
+}
+
+void audioAssetsFree() {
+    if (loaderThread.joinable()) loaderThread.join();
+    Mix_HaltMusic();
+    Mix_HaltChannel(-1);
+    for (int i = 0; i < NUM_AUDIO_ASSETS; i++) {
+        if (audioAssets[i].music) Mix_FreeMusic(audioAssets[i].music);
+        if (audioAssets[i].chunk) Mix_FreeChunk(audioAssets[i].chunk);
+        audioAssets[i].music = nullptr;
+        audioAssets[i].chunk = nullptr;
+        audioAssets[i].loaded = false;
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include "common.h"
+#include <string>
+
+// assets.pack: "MCPK", u32 version, u32 entry count, then for each entry a
+// u32 name length, the name, u64 offset and u64 size, followed by the file
+// data aligned to ASSET_PACK_ALIGN. Names are the asset's path relative to
+// the project directory, so a missing pack falls back to the same files.
+const Uint32 ASSET_PACK_VERSION = 1;
+const Uint64 ASSET_PACK_ALIGN = 16;
+
+bool assetPackWrite(const std::string& path, const std::vector<std::string>& files);
+bool assetPackOpen(const std::string& path);
+void assetPackClose();
+bool assetPackFind(const std::string& name, const Uint8*& data, size_t& size);
+
+// Every music track and sound effect is decoded once on a background thread
+// at startup, from the memory-mapped pack when it is open and from disk
+// otherwise. The getters wait only for the requested clip and return nullptr
+// if it could not be loaded. The clips stay owned by the cache.
+void audioAssetsLoadAsync();
+Mix_Music* audioAssetMusic(const char* name);
+Mix_Chunk* audioAssetChunk(const char* name);
+void audioAssetsFree();
+
+#endif
@@ -0,0 +1,206 @@
+#include "audio_engine.h"
+#include "asset_pack.h"
+#include "thread_config.h"
+#include <atomic>
+#include <chrono>
+
+static const int TOTAL_CHANNELS = 16;
+static const int SFX_CHANNELS = 4;
+static const int SFX_GROUP = 1;
+static const int LATENCY_HISTORY = 256;
+
+static bool opened = false;
+static int deviceFreq = 0;
+static int deviceChannels = 0;
+static Uint16 deviceFormat = 0;
+static int deviceBuffer = 0;
+
+static Mix_Chunk* synthChunks[NUM_SOUND_EFFECTS] = {};
+static std::vector<Sint16> synthPcm[NUM_SOUND_EFFECTS];
+
+static std::atomic<bool> triggerPending{false};
+static std::atomic<Uint64> triggerTimeUs{0};
+static std::atomic<Uint32> mixDelayUs[LATENCY_HISTORY];
+static std::atomic<Uint32> mixDelayCount{0};
+
+static std::atomic<Uint32> mixClockSeq{0};
+static std::atomic<Uint64> mixedFrames{0};
+static std::atomic<Uint64> mixedAtUs{0};
+static Uint64 musicStartFrame = 0;
+static bool musicRunning = false;
+static double calibrationOffsetMs = 0;
+
+static Uint64 nowUs() {
+    return (Uint64)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Runs on the audio thread after each buffer is mixed. Mix_PlayChannel holds
+// the audio lock, so a pending trigger is always part of this buffer.
+static void postMix(void*, Uint8*, int len) {
+    threadConfigAudioThread();
+    int frameBytes = deviceChannels * (SDL_AUDIO_BITSIZE(deviceFormat) / 8);
+    if (frameBytes > 0) {
+        mixClockSeq.fetch_add(1);
+        mixedFrames.fetch_add(len / frameBytes);
+        mixedAtUs.store(nowUs());
+        mixClockSeq.fetch_add(1);
+    }
+
+    if (!triggerPending.exchange(false)) return;
+    Uint32 count = mixDelayCount.load(std::memory_order_relaxed);
+    mixDelayUs[count % LATENCY_HISTORY].store((Uint32)(nowUs() - triggerTimeUs.load()), std::memory_order_relaxed);
+    mixDelayCount.store(count + 1, std::memory_order_release);
+}
+
+// A decaying tone mixed with noise, written directly in the device format so
+// playback needs no conversion.
+static void synthesize(SoundEffect effect, float freq, float seconds, float noise) {
+    int frames = (int)(seconds * deviceFreq);
+    std::vector<Sint16>& pcm = synthPcm[effect];
+    pcm.resize((size_t)frames * deviceChannels);
+
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<float> noiseDist(-1.0f, 1.0f);
+    for (int i = 0; i < frames; i++) {
+        float t = (float)i / deviceFreq;
+        float env = 1.0f - (float)i / frames;
+        env = env * env * env;
+        float v = (std::sin(2.0f * 3.14159265f * freq * t) * (1.0f - noise) + noiseDist(gen) * noise) * env * 0.6f;
+        for (int c = 0; c < deviceChannels; c++) {
+            pcm[(size_t)i * deviceChannels + c] = (Sint16)(v * 32767);
+        }
+    }
+    synthChunks[effect] = Mix_QuickLoad_RAW((Uint8*)pcm.data(), (Uint32)(pcm.size() * sizeof(Sint16)));
+}
+
+bool audioOpen(int bufferSamples) {
+    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, bufferSamples) < 0) {
+        std::cerr << "SDL_mixer could not initialize: " << Mix_GetError() << std::endl;
+        return false;
+    }
+    Mix_QuerySpec(&deviceFreq, &deviceFormat, &deviceChannels);
+    deviceBuffer = bufferSamples;
+
+    Mix_AllocateChannels(TOTAL_CHANNELS);
+    Mix_ReserveChannels(SFX_CHANNELS);
+    Mix_GroupChannels(0, SFX_CHANNELS - 1, SFX_GROUP);
+
+    if (deviceFormat == AUDIO_S16SYS) {
+        synthesize(SFX_HIT, 110.0f, 0.08f, 0.5f);
+        synthesize(SFX_RETURN, 880.0f, 0.04f, 0.2f);
+    } else {
+        std::cerr << "Audio device is not 16-bit; synthesized effects are disabled." << std::endl;
+    }
+
+    Mix_SetPostMix(postMix, nullptr);
+    opened = true;
+    std::cout << "Audio: " << deviceFreq << " Hz, " << deviceBuffer << "-sample buffer ("
+              << audioBufferMs() << " ms)" << std::endl;
+    return true;
+}
+
+void audioClose() {
+    if (!opened) return;
+    Mix_SetPostMix(nullptr, nullptr);
+    Mix_HaltChannel(-1);
+    for (int i = 0; i < NUM_SOUND_EFFECTS; i++) {
+        if (synthChunks[i]) Mix_FreeChunk(synthChunks[i]);
+        synthChunks[i] = nullptr;
+        synthPcm[i].clear();
+    }
+    Mix_CloseAudio();
+    opened = false;
+}
+
+void sfxPlay(SoundEffect effect) {
+    if (!opened) return;
+    Mix_Chunk* chunk = synthChunks[effect];
+    if (effect == SFX_ARROW_SHOT) {
+        chunk = audioAssetChunk("audio and sound effects/arrow_shoot.mp3");
+        if (!chunk) chunk = synthChunks[SFX_RETURN];
+    }
+    if (!chunk) return;
+
+    int channel = Mix_GroupAvailable(SFX_GROUP);
+    if (channel < 0) channel = Mix_GroupOldest(SFX_GROUP);
+    triggerTimeUs.store(nowUs());
+    triggerPending.store(true);
+    Mix_PlayChannel(channel, chunk, 0);
+}
+
+void audioMusicStarted() {
+    if (!opened) return;
+    SDL_LockAudio();
+    musicStartFrame = mixedFrames.load();
+    SDL_UnlockAudio();
+    musicRunning = true;
+}
+
+void audioMusicStopped() {
+    musicRunning = false;
+}
+
+void audioSetCalibrationOffset(double ms) {
+    calibrationOffsetMs = ms;
+}
+
+// The callback bumps mixClockSeq around each update, so a read that sees the
+// same even sequence on both sides is consistent. Between callbacks the clock
+// advances with wall time, capped at one buffer.
+double audioMusicTime() {
+    if (!opened || !musicRunning || deviceFreq <= 0) return -1;
+    Uint64 frames, at;
+    Uint32 seq;
+    do {
+        seq = mixClockSeq.load();
+        frames = mixedFrames.load();
+        at = mixedAtUs.load();
+    } while ((seq & 1) || mixClockSeq.load() != seq);
+    if (frames <= musicStartFrame) return 0;
+
+    double bufferSec = (double)deviceBuffer / deviceFreq;
+    double sinceMix = std::min((nowUs() - at) / 1e6, bufferSec);
+    double t = (double)(frames - musicStartFrame) / deviceFreq - 2 * bufferSec + sinceMix
+               - calibrationOffsetMs / 1000.0;
+    return std::max(t, 0.0);
+}
+
+double audioBufferMs() {
+    return deviceFreq > 0 ? 1000.0 * deviceBuffer / deviceFreq : 0;
+}
+
+static std::vector<double> mixDelaysMs() {
+    Uint32 count = mixDelayCount.load(std::memory_order_acquire);
+    Uint32 n = std::min<Uint32>(count, LATENCY_HISTORY);
+    std::vector<double> delays;
+    for (Uint32 i = count - n; i < count; i++) {
+        delays.push_back(mixDelayUs[i % LATENCY_HISTORY].load(std::memory_order_relaxed) / 1000.0);
+    }
+    return delays;
+}
+
+double audioOutputLatencyMs() {
+    std::vector<double> delays = mixDelaysMs();
+    if (delays.empty()) return -1;
+    double sum = 0;
+    for (double d : delays) sum += d;
+    return sum / delays.size() + audioBufferMs();
+}
+
+void audioPrintStats() {
+    if (!opened) return;
+    std::vector<double> delays = mixDelaysMs();
+    std::cout << "Audio buffer: " << deviceBuffer << " samples (" << audioBufferMs() << " ms)";
+    if (delays.empty()) {
+        std::cout << ", no sound effects played" << std::endl;
+        return;
+    }
+    std::sort(delays.begin(), delays.end());
+    double sum = 0;
+    for (double d : delays) sum += d;
+    std::cout << ", effect trigger-to-mix mean " << sum / delays.size()
+              << " ms, p90 " << delays[(delays.size() - 1) * 9 / 10]
+              << " ms, max " << delays.back() << " ms over " << delays.size() << " effects" << std::endl;
+    std::cout << "Estimated effect output latency: " << audioOutputLatencyMs() << " ms" << std::endl;
+}
@@ -0,0 +1,37 @@
+#ifndef AUDIO_ENGINE_H
+#define AUDIO_ENGINE_H
+
+#include "common.h"
+
+// Mixer setup and gameplay sound effects. Effects play on a reserved channel
+// group so music and ambient sounds can never take their channels, and are
+// either pre-decoded clips from the asset cache or PCM synthesized at open in
+// the device format. Games trigger them in the simulation step that caused
+// them. A post-mix callback measures how long a triggered effect waits before
+// it is mixed; adding the device buffer gives the output latency estimate.
+enum SoundEffect {
+    SFX_ARROW_SHOT,
+    SFX_HIT,
+    SFX_RETURN,
+    NUM_SOUND_EFFECTS
+};
+
+const int AUDIO_DEFAULT_BUFFER = 2048;
+const int AUDIO_LOW_LATENCY_BUFFER = 256;
+
+bool audioOpen(int bufferSamples);
+void audioClose();
+void sfxPlay(SoundEffect effect);
+double audioBufferMs();
+double audioOutputLatencyMs();
+void audioPrintStats();
+
+// Song clock derived from the frames the mixer has consumed since the music
+// started, minus the device buffers still queued and the calibration offset.
+// audioMusicTime returns seconds, or -1 when no music clock is running.
+void audioMusicStarted();
+void audioMusicStopped();
+double audioMusicTime();
+void audioSetCalibrationOffset(double ms);
+
+#endif
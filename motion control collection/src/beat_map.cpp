@@ -0,0 +1,296 @@
+#include "beat_map.h"
+#include "asset_pack.h"
+#include <algorithm>
+#include <iomanip>
+
+static const int ANALYSIS_RATE = 11025;
+static const int FRAME_SIZE = 1024;
+static const int HOP_SIZE = 256;
+static const int BLOCK_FRAMES = 256;
+static const double MIN_BPM = 70.0;
+static const double MAX_BPM = 180.0;
+static const double PREFERRED_BPM = 120.0;
+static const double TIGHTNESS = 100.0;
+
+static Uint64 contentHash(const Uint8* data, size_t size) {
+    Uint64 hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Decodes through the open mixer, so the samples arrive in the device format.
+static bool decodeMono(const Uint8* data, size_t size, std::vector<float>& mono, int& sampleRate) {
+    int freq, channels;
+    Uint16 format;
+    if (!Mix_QuerySpec(&freq, &format, &channels)) {
+        std::cerr << "Beat analysis needs the audio mixer to be open" << std::endl;
+        return false;
+    }
+    if (format != AUDIO_S16SYS && format != AUDIO_F32SYS) {
+        std::cerr << "Beat analysis does not support this audio format" << std::endl;
+        return false;
+    }
+    Mix_Chunk* chunk = Mix_LoadWAV_RW(SDL_RWFromConstMem(data, (int)size), 1);
+    if (!chunk) {
+        std::cerr << "Could not decode audio for beat analysis: " << Mix_GetError() << std::endl;
+        return false;
+    }
+
+    size_t frames = chunk->alen / (SDL_AUDIO_BITSIZE(format) / 8 * channels);
+    mono.resize(frames);
+    for (size_t i = 0; i < frames; i++) {
+        float sum = 0;
+        for (int c = 0; c < channels; c++) {
+            if (format == AUDIO_S16SYS) {
+                sum += ((const Sint16*)chunk->abuf)[i * channels + c] / 32768.0f;
+            } else {
+                sum += ((const float*)chunk->abuf)[i * channels + c];
+            }
+        }
+        mono[i] = sum / channels;
+    }
+    Mix_FreeChunk(chunk);
+    sampleRate = freq;
+    return true;
+}
+
+// Spectral flux: how much the log-magnitude spectrum rose since the previous
+// frame. Frames are transformed a block at a time as rows of one matrix so
+// the DFT and the flux reduction run over contiguous data.
+static std::vector<float> onsetEnvelope(const std::vector<float>& samples) {
+    int numFrames = ((int)samples.size() - FRAME_SIZE) / HOP_SIZE + 1;
+    std::vector<float> envelope(numFrames, 0.0f);
+
+    std::vector<float> window(FRAME_SIZE);
+    for (int i = 0; i < FRAME_SIZE; i++) {
+        window[i] = 0.5f - 0.5f * std::cos(2.0f * 3.14159265f * i / (FRAME_SIZE - 1));
+    }
+
+    for (int start = 0; start < numFrames; start += BLOCK_FRAMES) {
+        int first = std::max(0, start - 1);
+        int last = std::min(numFrames, start + BLOCK_FRAMES);
+        int rows = last - first;
+        if (rows < 2) break;
+
+        cv::Mat frames(rows, FRAME_SIZE, CV_32F);
+        for (int r = 0; r < rows; r++) {
+            const float* src = &samples[(size_t)(first + r) * HOP_SIZE];
+            float* dst = frames.ptr<float>(r);
+            for (int i = 0; i < FRAME_SIZE; i++) dst[i] = src[i] * window[i];
+        }
+
+        cv::Mat spectrum, parts[2], magnitude;
+        cv::dft(frames, spectrum, cv::DFT_ROWS | cv::DFT_COMPLEX_OUTPUT);
+        cv::split(spectrum, parts);
+        cv::magnitude(parts[0].colRange(0, FRAME_SIZE / 2 + 1), parts[1].colRange(0, FRAME_SIZE / 2 + 1), magnitude);
+        magnitude.convertTo(magnitude, CV_32F, 100.0, 1.0);
+        cv::log(magnitude, magnitude);
+
+        cv::Mat rise, flux;
+        cv::subtract(magnitude.rowRange(1, rows), magnitude.rowRange(0, rows - 1), rise);
+        cv::max(rise, 0.0, rise);
+        cv::reduce(rise, flux, 1, cv::REDUCE_SUM);
+        for (int r = 0; r < rows - 1; r++) {
+            envelope[first + 1 + r] = flux.at<float>(r);
+        }
+    }
+
+    // Remove the slowly varying loudness so only sharp rises remain.
+    int half = std::max(1, ANALYSIS_RATE / HOP_SIZE / 4);
+    std::vector<float> onsets(numFrames);
+    double sum = 0;
+    int count = 0;
+    int lo = 0, hi = 0;
+    for (int i = 0; i < numFrames; i++) {
+        while (hi < numFrames && hi <= i + half) {
+            sum += envelope[hi++];
+            count++;
+        }
+        while (lo < i - half) {
+            sum -= envelope[lo++];
+            count--;
+        }
+        onsets[i] = std::max(0.0f, envelope[i] - (float)(sum / count));
+    }
+
+    double sq = 0;
+    for (float v : onsets) sq += (double)v * v;
+    float rms = (float)std::sqrt(sq / std::max(1, numFrames));
+    if (rms > 0) {
+        for (float& v : onsets) v /= rms;
+    }
+    return onsets;
+}
+
+// Beat period in frames: the autocorrelation peak in the allowed tempo range,
+// weighted towards PREFERRED_BPM so half and double tempos lose close calls.
+static double estimatePeriod(const std::vector<float>& onsets, double frameRate) {
+    int minLag = std::max(1, (int)(60.0 / MAX_BPM * frameRate));
+    int maxLag = (int)(60.0 / MIN_BPM * frameRate) + 1;
+    int n = (int)onsets.size();
+    double preferredLag = 60.0 / PREFERRED_BPM * frameRate;
+
+    std::vector<double> score(maxLag + 2, 0.0);
+    for (int lag = minLag - 1; lag <= maxLag + 1 && lag < n; lag++) {
+        double ac = 0;
+        for (int i = 0; i + lag < n; i++) ac += onsets[i] * onsets[i + lag];
+        ac /= (n - lag);
+        double octaves = std::log2(lag / preferredLag);
+        score[lag] = ac * std::exp(-0.5 * octaves * octaves);
+    }
+
+    int best = minLag;
+    for (int lag = minLag; lag <= maxLag && lag < n; lag++) {
+        if (score[lag] > score[best]) best = lag;
+    }
+    double a = score[best - 1], b = score[best], c = score[best + 1];
+    double denom = a - 2 * b + c;
+    double offset = denom < 0 ? 0.5 * (a - c) / denom : 0;
+    return best + std::max(-0.5, std::min(0.5, offset));
+}
+
+// Dynamic-programming beat tracker: each frame takes the best earlier beat
+// within half to twice a period, penalised by how far the gap strays from the
+// period, then the best chain is traced back from the end.
+static std::vector<int> trackBeats(const std::vector<float>& onsets, double period) {
+    int n = (int)onsets.size();
+    std::vector<double> score(n);
+    std::vector<int> previous(n, -1);
+    for (int i = 0; i < n; i++) {
+        double best = 0;
+        int from = std::max(0, i - (int)std::round(2 * period));
+        int to = i - (int)std::round(period / 2);
+        for (int j = from; j <= to; j++) {
+            double gap = std::log((i - j) / period);
+            double s = score[j] - TIGHTNESS * gap * gap;
+            if (previous[i] < 0 || s > best) {
+                best = s;
+                previous[i] = j;
+            }
+        }
+        score[i] = onsets[i] + (previous[i] >= 0 ? best : 0);
+    }
+
+    int end = n - 1;
+    for (int i = std::max(0, n - (int)std::round(period)); i < n; i++) {
+        if (score[i] > score[end]) end = i;
+    }
+    std::vector<int> beats;
+    for (int i = end; i >= 0; i = previous[i]) beats.push_back(i);
+    std::reverse(beats.begin(), beats.end());
+    return beats;
+}
+
+bool beatMapAnalyze(const std::vector<float>& mono, int sampleRate, BeatMap& map) {
+    int decimation = std::max(1, sampleRate / ANALYSIS_RATE);
+    double rate = (double)sampleRate / decimation;
+    std::vector<float> samples(mono.size() / decimation);
+    for (size_t i = 0; i < samples.size(); i++) {
+        float sum = 0;
+        for (int k = 0; k < decimation; k++) sum += mono[i * decimation + k];
+        samples[i] = sum / decimation;
+    }
+
+    double frameRate = rate / HOP_SIZE;
+    if (samples.size() < (size_t)(FRAME_SIZE + 4.0 * 60.0 / MIN_BPM * rate)) {
+        std::cerr << "Audio is too short for beat analysis" << std::endl;
+        return false;
+    }
+
+    std::vector<float> onsets = onsetEnvelope(samples);
+    double period = estimatePeriod(onsets, frameRate);
+    std::vector<int> beatFrames = trackBeats(onsets, period);
+
+    map.tempo = 60.0 * frameRate / period;
+    map.length = (double)mono.size() / sampleRate;
+    map.beats.clear();
+    for (int frame : beatFrames) {
+        map.beats.push_back(((double)frame * HOP_SIZE + FRAME_SIZE / 2) / rate);
+    }
+    return true;
+}
+
+static bool readBeatMap(const std::string& path, Uint64 hash, BeatMap& map) {
+    std::ifstream in(path);
+    std::string magic;
+    Uint32 version = 0;
+    Uint64 fileHash = 0;
+    if (!(in >> magic >> version >> std::hex >> fileHash >> std::dec)) return false;
+    if (magic != "MCBEATS" || version != BEAT_MAP_VERSION || fileHash != hash) return false;
+
+    BeatMap loaded;
+    size_t count = 0;
+    if (!(in >> loaded.tempo >> loaded.length >> count)) return false;
+    loaded.beats.resize(count);
+    for (double& beat : loaded.beats) {
+        if (!(in >> beat)) return false;
+    }
+    map = loaded;
+    return true;
+}
+
+static bool writeBeatMap(const std::string& path, Uint64 hash, const BeatMap& map) {
+    std::ofstream out(path);
+    if (!out.good()) return false;
+    out << "MCBEATS " << BEAT_MAP_VERSION << " " << std::hex << hash << std::dec << "\n";
+    out << std::fixed << std::setprecision(4) << map.tempo << " " << map.length << " " << map.beats.size() << "\n";
+    for (double beat : map.beats) out << beat << "\n";
+    return out.good();
+}
+
+bool beatMapLoad(const std::string& audioName, BeatMap& map) {
+    const Uint8* data;
+    size_t size;
+    std::vector<Uint8> fileData;
+    if (!assetPackFind(audioName, data, size)) {
+        std::ifstream in(audioName, std::ios::binary);
+        if (!in.good()) return false;
+        fileData.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        data = fileData.data();
+        size = fileData.size();
+    }
+
+    Uint64 hash = contentHash(data, size);
+    std::string cachePath = audioName + ".beatmap";
+    if (readBeatMap(cachePath, hash, map)) return true;
+
+    std::cout << "Analyzing beats in " << audioName << "..." << std::endl;
+    std::vector<float> mono;
+    int sampleRate;
+    if (!decodeMono(data, size, mono, sampleRate) || !beatMapAnalyze(mono, sampleRate, map)) {
+        return false;
+    }
+    if (!writeBeatMap(cachePath, hash, map)) {
+        std::cerr << "Could not write beat map: " << cachePath << std::endl;
+    }
+    std::cout << "Beat map: " << map.tempo << " BPM, " << map.beats.size() << " beats" << std::endl;
+    return true;
+}
+
+static void beatsAround(const BeatMap& map, double t, double& prev, double& next) {
+    if (map.beats.empty() || map.length <= 0) {
+        double period = 60.0 / map.tempo;
+        prev = std::floor(t / period) * period;
+        next = prev + period;
+        return;
+    }
+    double loop = std::floor(t / map.length) * map.length;
+    auto it = std::upper_bound(map.beats.begin(), map.beats.end(), t - loop);
+    next = it == map.beats.end() ? loop + map.length + map.beats.front() : loop + *it;
+    prev = it == map.beats.begin() ? loop - map.length + map.beats.back() : loop + *(it - 1);
+}
+
+double beatMapNextBeat(const BeatMap& map, double t) {
+    double prev, next;
+    beatsAround(map, t, prev, next);
+    return next;
+}
+
+double beatMapPhase(const BeatMap& map, double t) {
+    double prev, next;
+    beatsAround(map, t, prev, next);
+    return next > prev ? (t - prev) / (next - prev) : 0;
+}
@@ -0,0 +1,28 @@
+#ifndef BEAT_MAP_H
+#define BEAT_MAP_H
+
+#include "common.h"
+#include <string>
+
+// Beat times for a song, from an onset/tempo analysis of its decoded audio.
+// The map is cached next to the audio file as "<file>.beatmap", keyed by a
+// hash of the file contents, so a song is analyzed once (normally by
+// analyze_beats at build time) and only loaded afterwards. A map with no
+// beats is a fixed grid at its tempo.
+const Uint32 BEAT_MAP_VERSION = 1;
+
+struct BeatMap {
+    double tempo = 120.0;
+    double length = 0;
+    std::vector<double> beats;
+};
+
+bool beatMapAnalyze(const std::vector<float>& mono, int sampleRate, BeatMap& map);
+bool beatMapLoad(const std::string& audioName, BeatMap& map);
+
+// Times are song positions in seconds; a looping song repeats its beats
+// every map.length seconds.
+double beatMapNextBeat(const BeatMap& map, double t);
+double beatMapPhase(const BeatMap& map, double t);
+
+#endif
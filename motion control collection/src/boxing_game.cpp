@@ -1,4 +1,15 @@
 #include "boxing_game.h"
+#include "session.h"
+#include "asset_pack.h"
+#include "audio_engine.h"
+#include "gesture.h"
+#include "target_swarm.h"
+#include "particles.h"
+
+const int SWARM_TARGET_COUNT = 400;
+const float SWARM_SPAWN_RATE = 200.0f;
+const float SWARM_COMBO_TIMEOUT = 1.0f;
+const double PUNCH_HIT_WINDOW = 0.3;
 
 struct BoxingTarget {
     float x, y;
@@ -9,108 +20,181 @@ struct BoxingTarget {
     Color color;
 };
 
-void runBoxing(SDL_Renderer* renderer, PoseDetector& poseDetector, cv::VideoCapture& cap,
-               bool useCamera, cv::Mat& currentFrame, bool& returnToMenu, Mix_Music* menuMusic) {
-    Mix_Music* boxingMusic = Mix_LoadMUS("audio and sound effects/boxing_background.mp3");
-    
-    if (menuMusic) {
-        Mix_HaltMusic();
-    }
-    
-    if (boxingMusic) {
-        Mix_PlayMusic(boxingMusic, -1);
-        Mix_VolumeMusic(MIX_MAX_VOLUME / 3);
-    }
-    
+struct BoxingState {
     std::vector<BoxingTarget> targets;
     int score = 0;
     int combo = 0;
     float spawnTimer = 0;
-    bool running = true;
-    
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> xDist(100, GAME_WIDTH - 100);
-    std::uniform_real_distribution<> yDist(100, GAME_HEIGHT - 100);
-    std::uniform_int_distribution<> colorDist(0, 2);
-    
+    bool swarmMode = false;
+    TargetSwarm swarm;
+    float swarmSpawnBudget = 0;
+    float comboTimer = 0;
+    ParticleSystem particles;
+
     float leftHandScreenX = GAME_WIDTH * 0.3f;
     float leftHandScreenY = GAME_HEIGHT * 0.5f;
     float rightHandScreenX = GAME_WIDTH * 0.7f;
     float rightHandScreenY = GAME_HEIGHT * 0.5f;
 
-    while (running && !returnToMenu) {
-        SDL_Event event;
-        while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_QUIT) { running = false; returnToMenu = false; }
-            else if (event.type == SDL_KEYDOWN) {
-                if (event.key.keysym.sym == SDLK_ESCAPE) returnToMenu = true;
-                if (event.key.keysym.sym == SDLK_q) returnToMenu = true;
+    double lastPunchTime[2] = {-1, -1};
+    float lastPunchSpeed[2] = {0, 0};
+};
+
+class BoxingGame : public Game {
+public:
+    explicit BoxingGame(Mix_Music* menuMusic)
+        : menuMusic(menuMusic), gen(sessionSeed()), xDist(100, GAME_WIDTH - 100),
+          yDist(100, GAME_HEIGHT - 100), colorDist(0, 2), state(BoxingState()) {}
+
+    void onEnter() override {
+        Mix_Music* boxingMusic = audioAssetMusic("audio and sound effects/boxing_background.mp3");
+        if (menuMusic) {
+            Mix_HaltMusic();
+        }
+        if (boxingMusic) {
+            Mix_PlayMusic(boxingMusic, -1);
+            Mix_VolumeMusic(MIX_MAX_VOLUME / 3);
+        }
+    }
+
+    void onExit() override {
+        Mix_HaltMusic();
+        if (menuMusic) {
+            Mix_PlayMusic(menuMusic, -1);
+            Mix_VolumeMusic(MIX_MAX_VOLUME / 3);
+        }
+    }
+
+    void update(float dt, const GameInput& input) override {
+        BoxingState& s = state.back();
+        for (const SDL_Event& event : input.events) {
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_m) {
+                s.swarmMode = !s.swarmMode;
+                s.targets.clear();
+                s.swarm.clear();
+                s.combo = 0;
             }
         }
+        s.particles.update(dt);
 
-        if (useCamera && cap.read(currentFrame)) {
-            cv::flip(currentFrame, currentFrame, 1);
-            poseDetector.detectBothHands(currentFrame);
-            leftHandScreenX = poseDetector.leftHandX * GAME_WIDTH;
-            leftHandScreenY = poseDetector.leftHandY * GAME_HEIGHT;
-            rightHandScreenX = poseDetector.rightHandX * GAME_WIDTH;
-            rightHandScreenY = poseDetector.rightHandY * GAME_HEIGHT;
+        // A target reached by a punch rather than a slow reach earns a bonus
+        // for the punch speed.
+        for (const GestureEvent& gesture : input.pose.gestures) {
+            if (gesture.type != GESTURE_PUNCH) continue;
+            int hand = gesture.part == POSE_LEFT_WRIST ? 0 : 1;
+            s.lastPunchTime[hand] = gesture.time;
+            s.lastPunchSpeed[hand] = gesture.speed;
+        }
+        auto punchBonus = [&](int hand) {
+            if (s.lastPunchTime[hand] < 0 || input.time - s.lastPunchTime[hand] > PUNCH_HIT_WINDOW) return 0;
+            s.lastPunchTime[hand] = -1;
+            return (int)(std::min(s.lastPunchSpeed[hand], 10.0f) * 10);
+        };
+
+        if (input.pose.detected) {
+            s.leftHandScreenX = input.pose.leftHandX * GAME_WIDTH;
+            s.leftHandScreenY = input.pose.leftHandY * GAME_HEIGHT;
+            s.rightHandScreenX = input.pose.rightHandX * GAME_WIDTH;
+            s.rightHandScreenY = input.pose.rightHandY * GAME_HEIGHT;
         } else {
-            int mx, my;
-            SDL_GetMouseState(&mx, &my);
-            rightHandScreenX = mx;
-            rightHandScreenY = my;
-            
-            const Uint8* keys = SDL_GetKeyboardState(NULL);
-            if (keys[SDL_SCANCODE_W]) leftHandScreenY -= 10;
-            if (keys[SDL_SCANCODE_S]) leftHandScreenY += 10;
-            if (keys[SDL_SCANCODE_A]) leftHandScreenX -= 10;
-            if (keys[SDL_SCANCODE_D]) leftHandScreenX += 10;
-            leftHandScreenX = std::max(0.0f, std::min((float)GAME_WIDTH, leftHandScreenX));
-            leftHandScreenY = std::max(0.0f, std::min((float)GAME_HEIGHT, leftHandScreenY));
+            s.rightHandScreenX = input.mouseX;
+            s.rightHandScreenY = input.mouseY;
+
+            if (input.keys[SDL_SCANCODE_W]) s.leftHandScreenY -= 10;
+            if (input.keys[SDL_SCANCODE_S]) s.leftHandScreenY += 10;
+            if (input.keys[SDL_SCANCODE_A]) s.leftHandScreenX -= 10;
+            if (input.keys[SDL_SCANCODE_D]) s.leftHandScreenX += 10;
+            s.leftHandScreenX = std::max(0.0f, std::min((float)GAME_WIDTH, s.leftHandScreenX));
+            s.leftHandScreenY = std::max(0.0f, std::min((float)GAME_HEIGHT, s.leftHandScreenY));
         }
 
-        spawnTimer += 0.016f;
-        if (spawnTimer > 1.5f && targets.size() < 5) {
+        if (s.swarmMode) {
+            s.swarmSpawnBudget += SWARM_SPAWN_RATE * dt;
+            while (s.swarmSpawnBudget >= 1.0f && s.swarm.count < SWARM_TARGET_COUNT) {
+                s.swarm.spawn(gen);
+                s.swarmSpawnBudget -= 1.0f;
+            }
+            s.swarmSpawnBudget = std::min(s.swarmSpawnBudget, 1.0f);
+
+            s.swarm.update(dt);
+            s.swarm.compact();
+            s.swarm.rebuildGrid();
+            int leftHits = s.swarm.hitTest(s.leftHandScreenX, s.leftHandScreenY);
+            int rightHits = s.swarm.hitTest(s.rightHandScreenX, s.rightHandScreenY);
+            int hits = leftHits + rightHits;
+            s.swarm.compact();
+            if (leftHits > 0) {
+                s.particles.burst(s.leftHandScreenX, s.leftHandScreenY, PARTICLES_HIT, 0.5f * std::min(leftHits, 4));
+            }
+            if (rightHits > 0) {
+                s.particles.burst(s.rightHandScreenX, s.rightHandScreenY, PARTICLES_HIT, 0.5f * std::min(rightHits, 4));
+            }
+
+            s.comboTimer += dt;
+            if (hits > 0) {
+                sfxPlay(SFX_HIT);
+                s.comboTimer = 0;
+                for (int h = 0; h < hits; h++) {
+                    s.combo++;
+                    s.score += 10 * s.combo;
+                }
+            } else if (s.comboTimer > SWARM_COMBO_TIMEOUT) {
+                s.combo = 0;
+            }
+        }
+
+        s.spawnTimer += dt;
+        if (!s.swarmMode && s.spawnTimer > 1.5f && s.targets.size() < 5) {
             BoxingTarget t;
             t.x = xDist(gen);
             t.y = yDist(gen);
-            t.radius = 40 + (std::rand() % 20);
+            t.radius = 40 + (int)(gen() % 20);
             t.maxLifetime = 3.0f;
             t.lifetime = t.maxLifetime;
             t.active = true;
             Color colors[] = {RED, ORANGE, YELLOW};
             t.color = colors[colorDist(gen)];
-            targets.push_back(t);
-            spawnTimer = 0;
+            s.targets.push_back(t);
+            s.spawnTimer = 0;
         }
 
-        for (auto& t : targets) {
+        for (auto& t : s.targets) {
             if (!t.active) continue;
-            t.lifetime -= 0.016f;
-            if (t.lifetime <= 0) { t.active = false; combo = 0; continue; }
-
-            float dxL = leftHandScreenX - t.x;
-            float dyL = leftHandScreenY - t.y;
-            float dxR = rightHandScreenX - t.x;
-            float dyR = rightHandScreenY - t.y;
-            
-            if (std::sqrt(dxL*dxL + dyL*dyL) < t.radius || std::sqrt(dxR*dxR + dyR*dyR) < t.radius) {
+            t.lifetime -= dt;
+            if (t.lifetime <= 0) { t.active = false; s.combo = 0; continue; }
+
+            float dxL = s.leftHandScreenX - t.x;
+            float dyL = s.leftHandScreenY - t.y;
+            float dxR = s.rightHandScreenX - t.x;
+            float dyR = s.rightHandScreenY - t.y;
+
+            bool leftHit = std::sqrt(dxL*dxL + dyL*dyL) < t.radius;
+            bool rightHit = std::sqrt(dxR*dxR + dyR*dyR) < t.radius;
+            if (leftHit || rightHit) {
                 t.active = false;
-                combo++;
-                score += 100 * combo;
+                s.combo++;
+                int bonus = punchBonus(leftHit ? 0 : 1);
+                s.score += 100 * s.combo + bonus;
+                s.particles.burst(t.x, t.y, PARTICLES_HIT, 1.0f + bonus / 100.0f);
+                sfxPlay(SFX_HIT);
             }
         }
 
-        targets.erase(std::remove_if(targets.begin(), targets.end(), 
-            [](const BoxingTarget& t) { return !t.active; }), targets.end());
+        s.targets.erase(std::remove_if(s.targets.begin(), s.targets.end(),
+            [](const BoxingTarget& t) { return !t.active; }), s.targets.end());
+    }
 
+    void render(SDL_Renderer* renderer) override {
+        BoxingState& s = state.front();
         SDL_SetRenderDrawColor(renderer, 30, 30, 50, 255);
         SDL_Rect bg = {0, 0, GAME_WIDTH, GAME_HEIGHT};
         SDL_RenderFillRect(renderer, &bg);
 
-        for (auto& t : targets) {
+        if (s.swarmMode) {
+            s.swarm.draw(renderer);
+        }
+
+        for (auto& t : s.targets) {
             if (!t.active) continue;
             float alpha = t.lifetime / t.maxLifetime;
             SDL_SetRenderDrawColor(renderer, t.color.r, t.color.g, t.color.b, (Uint8)(alpha * 255));
@@ -125,29 +209,33 @@ void runBoxing(SDL_Renderer* renderer, PoseDetector& poseDetector, cv::VideoCapt
             }
         }
 
+        s.particles.draw(renderer);
+
         SDL_SetRenderDrawColor(renderer, BLUE.r, BLUE.g, BLUE.b, BLUE.a);
-        drawFilledCircle(renderer, (int)leftHandScreenX, (int)leftHandScreenY, 25);
+        drawFilledCircle(renderer, (int)s.leftHandScreenX, (int)s.leftHandScreenY, 25);
         SDL_SetRenderDrawColor(renderer, RED.r, RED.g, RED.b, RED.a);
-        drawFilledCircle(renderer, (int)rightHandScreenX, (int)rightHandScreenY, 25);
+        drawFilledCircle(renderer, (int)s.rightHandScreenX, (int)s.rightHandScreenY, 25);
 
         SDL_SetRenderDrawColor(renderer, WHITE.r, WHITE.g, WHITE.b, WHITE.a);
-        drawNumber(renderer, score, 20, 20, 30);
-        
-        if (combo > 1) {
+        drawNumber(renderer, s.score, 20, 20, 30);
+
+        if (s.combo > 1) {
             SDL_SetRenderDrawColor(renderer, YELLOW.r, YELLOW.g, YELLOW.b, YELLOW.a);
-            drawNumber(renderer, combo, GAME_WIDTH - 100, 20, 25);
+            drawNumber(renderer, s.combo, GAME_WIDTH - 100, 20, 25);
         }
-
-        drawCameraFeed(renderer, currentFrame, useCamera);
-        SDL_RenderPresent(renderer);
-        SDL_Delay(16);
-    }
-    
-    Mix_HaltMusic();
-    if (boxingMusic) Mix_FreeMusic(boxingMusic);
-    
-    if (menuMusic) {
-        Mix_PlayMusic(menuMusic, -1);
-        Mix_VolumeMusic(MIX_MAX_VOLUME / 3);
     }
+
+    void publish() override { state.publish(); }
+
+private:
+    Mix_Music* menuMusic;
+    std::mt19937 gen;
+    std::uniform_real_distribution<> xDist;
+    std::uniform_real_distribution<> yDist;
+    std::uniform_int_distribution<> colorDist;
+    DoubleBuffer<BoxingState> state;
+};
+
+std::unique_ptr<Game> createBoxing(Mix_Music* menuMusic) {
+    return std::make_unique<BoxingGame>(menuMusic);
 }
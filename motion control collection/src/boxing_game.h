@@ -1,9 +1,8 @@
 #ifndef BOXING_GAME_H
 #define BOXING_GAME_H
 
-#include "common.h"
+#include "game.h"
 
-void runBoxing(SDL_Renderer* renderer, PoseDetector& poseDetector, cv::VideoCapture& cap,
-               bool useCamera, cv::Mat& currentFrame, bool& returnToMenu, Mix_Music* menuMusic);
+std::unique_ptr<Game> createBoxing(Mix_Music* menuMusic);
 
 #endif
@@ -0,0 +1,198 @@
+#include "capture_source.h"
+#include "latency_probe.h"
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+bool CaptureSource::openCamera() {
+    kind = SOURCE_CAMERA;
+#ifdef __APPLE__
+    return cv::VideoCapture::open(0, cv::CAP_AVFOUNDATION);
+#else
+    return cv::VideoCapture::open(0);
+#endif
+}
+
+bool CaptureSource::openV4l2(const std::string& device, int width, int height) {
+    kind = SOURCE_V4L2;
+    inputPath = device;
+    return v4l2.open(device, width, height, fps);
+}
+
+bool CaptureSource::openInput(const std::string& path, bool realtime, bool loop, double imageFps) {
+    this->realtime = realtime;
+    this->loop = loop;
+    inputPath = path;
+
+    std::error_code ec;
+    if (std::filesystem::is_directory(path, ec)) {
+        kind = SOURCE_IMAGES;
+        imageFiles.clear();
+        for (const auto& entry : std::filesystem::directory_iterator(path, ec)) {
+            if (!entry.is_regular_file()) continue;
+            std::string ext = entry.path().extension().string();
+            for (char& c : ext) c = (char)std::tolower((unsigned char)c);
+            if (ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp") {
+                imageFiles.push_back(entry.path().string());
+            }
+        }
+        std::sort(imageFiles.begin(), imageFiles.end());
+        if (imageFiles.empty()) {
+            std::cerr << "No images found in input directory: " << path << std::endl;
+            return false;
+        }
+        fps = imageFps;
+        std::cout << "Reading " << imageFiles.size() << " images from " << path
+                  << " at " << fps << " fps" << (realtime ? "" : " (unpaced)") << std::endl;
+        return true;
+    }
+
+    kind = SOURCE_VIDEO;
+    if (!cv::VideoCapture::open(path)) {
+        std::cerr << "Could not open input video: " << path << std::endl;
+        return false;
+    }
+    double videoFps = cv::VideoCapture::get(cv::CAP_PROP_FPS);
+    fps = videoFps > 0 ? videoFps : imageFps;
+    std::cout << "Reading video " << path << " at " << fps << " fps"
+              << (realtime ? "" : " (unpaced)") << std::endl;
+    return true;
+}
+
+bool CaptureSource::openGenerator(const std::string& name, FrameGenerator generator, double fps, bool realtime) {
+    kind = SOURCE_GENERATOR;
+    this->generator = generator;
+    this->fps = fps;
+    this->realtime = realtime;
+    loop = false;
+    inputPath = name;
+    std::cout << "Generating " << name << " frames at " << fps << " fps"
+              << (realtime ? "" : " (unpaced)") << std::endl;
+    return true;
+}
+
+bool CaptureSource::isOpened() const {
+    if (kind == SOURCE_IMAGES) return !imageFiles.empty();
+    if (kind == SOURCE_GENERATOR) return (bool)generator;
+    if (kind == SOURCE_V4L2) return v4l2.isOpened();
+    return cv::VideoCapture::isOpened();
+}
+
+bool CaptureSource::readAt(long index, cv::OutputArray image) {
+    if (kind == SOURCE_IMAGES) {
+        if (index >= (long)imageFiles.size()) return false;
+        cv::Mat img = cv::imread(imageFiles[index]);
+        if (img.empty()) return false;
+        image.assign(img);
+        return true;
+    }
+    if (kind == SOURCE_GENERATOR) {
+        cv::Mat img;
+        if (!generator(index, img)) return false;
+        image.assign(img);
+        return true;
+    }
+    return cv::VideoCapture::read(image);
+}
+
+bool CaptureSource::rewind() {
+    if (kind == SOURCE_VIDEO && !cv::VideoCapture::set(cv::CAP_PROP_POS_FRAMES, 0)) {
+        return false;
+    }
+    nextIndex = 0;
+    started = false;
+    return true;
+}
+
+bool CaptureSource::read(cv::OutputArray image) {
+    if (kind == SOURCE_CAMERA) {
+        if (!cv::VideoCapture::read(image)) return false;
+        captureTime = std::chrono::steady_clock::now();
+        return true;
+    }
+    if (kind == SOURCE_V4L2) {
+        // Decode straight into the caller's frame when it is a plain Mat.
+        bool ok;
+        if (image.kind() == cv::_InputArray::MAT) {
+            ok = v4l2.read(image.getMatRef());
+        } else {
+            cv::Mat frame;
+            ok = v4l2.read(frame);
+            if (ok) image.assign(frame);
+        }
+        if (!ok) return false;
+        // The age is measured from the kernel timestamp as read() returns.
+        captureTime = std::chrono::steady_clock::now() -
+                      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                          std::chrono::duration<double>(v4l2.frameAge()));
+        return true;
+    }
+    if (finished) return false;
+
+    auto now = std::chrono::steady_clock::now();
+    if (!started) {
+        startTime = now;
+        started = true;
+        if (framesDelivered == 0) firstStartTime = now;
+    }
+
+    if (realtime) {
+        double elapsed = std::chrono::duration<double>(now - startTime).count();
+        long due = (long)(elapsed * fps);
+        while (nextIndex < due) {
+            if (kind == SOURCE_VIDEO && !cv::VideoCapture::grab()) break;
+            nextIndex++;
+            framesDropped++;
+        }
+        if (nextIndex > due) {
+            std::this_thread::sleep_until(frameDueTime(nextIndex));
+        }
+    }
+
+    if (readAt(nextIndex, image)) {
+        nextIndex++;
+        framesDelivered++;
+        lastFrameTime = std::chrono::steady_clock::now();
+        captureTime = realtime ? frameDueTime(nextIndex - 1) : lastFrameTime;
+        if (latencyProbeActive()) {
+            latencyProbeFrameDelivered(*this, nextIndex - 1);
+        }
+        return true;
+    }
+
+    if (loop && nextIndex > 0 && rewind()) {
+        return read(image);
+    }
+
+    finished = true;
+    std::cout << "Input finished." << std::endl;
+    SDL_Event quit;
+    std::memset(&quit, 0, sizeof(quit));
+    quit.type = SDL_QUIT;
+    SDL_PushEvent(&quit);
+    return false;
+}
+
+std::chrono::steady_clock::time_point CaptureSource::frameDueTime(long index) const {
+    return startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(index / fps));
+}
+
+void CaptureSource::printStats() const {
+    if (kind == SOURCE_V4L2) {
+        if (v4l2.framesDelivered() == 0) return;
+        std::cout << "V4L2 " << inputPath << ": " << v4l2.framesDelivered() << " frames delivered, "
+                  << v4l2.framesSkipped() << " stale frames skipped, mean capture age "
+                  << v4l2.meanFrameAge() * 1000.0 << " ms" << std::endl;
+        return;
+    }
+    if (!isFileInput() || framesDelivered == 0) return;
+    double seconds = std::chrono::duration<double>(lastFrameTime - firstStartTime).count();
+    std::cout << "Input " << inputPath << ": " << framesDelivered << " frames delivered, "
+              << framesDropped << " dropped in " << seconds << " s";
+    if (seconds > 0) {
+        std::cout << " (" << framesDelivered / seconds << " fps)";
+    }
+    std::cout << std::endl;
+}
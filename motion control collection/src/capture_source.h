@@ -0,0 +1,65 @@
+#ifndef CAPTURE_SOURCE_H
+#define CAPTURE_SOURCE_H
+
+#include "common.h"
+#include "v4l2_capture.h"
+#include <chrono>
+#include <functional>
+#include <string>
+
+// Camera, video file or image-sequence directory behind the cv::VideoCapture
+// interface the games already take. File inputs are either paced like a live
+// camera (frames that are already late get dropped) or delivered as fast as
+// the caller reads them. When a file input runs out, an SDL_QUIT is pushed
+// unless looping was requested. A generator callback can stand in for a file
+// to produce synthetic frames; it returns false when the sequence ends. On
+// Linux the camera can instead be read directly through V4L2, which always
+// returns the newest frame.
+typedef std::function<bool(long index, cv::Mat& frame)> FrameGenerator;
+
+class CaptureSource : public cv::VideoCapture {
+public:
+    bool openCamera();
+    bool openV4l2(const std::string& device, int width, int height);
+    bool openInput(const std::string& path, bool realtime, bool loop, double imageFps);
+    bool openGenerator(const std::string& name, FrameGenerator generator, double fps, bool realtime);
+
+    bool isOpened() const override;
+    bool read(cv::OutputArray image) override;
+
+    bool isFileInput() const { return kind != SOURCE_CAMERA && kind != SOURCE_V4L2; }
+    double frameRate() const { return fps; }
+    std::chrono::steady_clock::time_point frameDueTime(long index) const;
+
+    // When the last frame read was captured: the kernel timestamp for V4L2,
+    // the due time for paced file input, otherwise when read() returned it.
+    std::chrono::steady_clock::time_point frameCaptureTime() const { return captureTime; }
+    void printStats() const;
+
+private:
+    enum SourceKind { SOURCE_CAMERA, SOURCE_V4L2, SOURCE_VIDEO, SOURCE_IMAGES, SOURCE_GENERATOR };
+
+    SourceKind kind = SOURCE_CAMERA;
+    std::string inputPath;
+    std::vector<std::string> imageFiles;
+    FrameGenerator generator;
+    V4l2Camera v4l2;
+    double fps = 30.0;
+    bool realtime = true;
+    bool loop = false;
+    bool finished = false;
+
+    long nextIndex = 0;
+    long framesDelivered = 0;
+    long framesDropped = 0;
+    bool started = false;
+    std::chrono::steady_clock::time_point startTime;
+    std::chrono::steady_clock::time_point firstStartTime;
+    std::chrono::steady_clock::time_point lastFrameTime;
+    std::chrono::steady_clock::time_point captureTime;
+
+    bool readAt(long index, cv::OutputArray image);
+    bool rewind();
+};
+
+#endif
@@ -1,4 +1,15 @@
 #include "common.h"
+#include "session.h"
+#include "perf_hud.h"
+#include "latency_probe.h"
+#include "trace.h"
+#include "gesture.h"
+#include "frame_prep.h"
+#include "pose_model.h"
+#include "idle_detector.h"
+#include "soak.h"
+#include "pose_pipeline.h"
+#include <cstdio>
 
 const Color WHITE = {255, 255, 255, 255};
 const Color BLACK = {0, 0, 0, 255};
@@ -16,13 +27,8 @@ const Color NET_COLOR = {50, 50, 50, 255};
 
 bool PoseDetector::init() {
     try {
-        std::string protoFile = "models/openpose_pose_coco.prototxt";
-        std::string weightsFile = "models/pose_iter_440000.caffemodel";
-        
-        std::ifstream protoTest(protoFile);
-        std::ifstream weightsTest(weightsFile);
-        if (protoTest.good() && weightsTest.good()) {
-            net = cv::dnn::readNetFromCaffe(protoFile, weightsFile);
+        std::string weightsFile;
+        if (poseModelLoad(net, weightsFile)) {
             net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
             net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
             initialized = true;
@@ -39,41 +45,84 @@ bool PoseDetector::init() {
 }
 
 float PoseDetector::detectArmPosition(cv::Mat& frame) {
+    if (sessionApplyPose(*this)) {
+        gestureUpdate(sessionTicks() / 1000.0, keypoints);
+        perfHudPoseUpdate("REPLAY");
+        return armCenterY;
+    }
+    if (soakApplyPose(*this)) {
+        sessionLogPose(*this);
+        gestureUpdate(sessionTicks() / 1000.0, keypoints);
+        perfHudPoseUpdate("SCRIPT");
+        return armCenterY;
+    }
     if (!initialized) {
-        return motionFallback(frame);
+        motionFallback(frame);
+        keypointsFromHands();
+        sessionLogPose(*this);
+        latencyProbePose(*this);
+        gestureUpdate(sessionTicks() / 1000.0, keypoints);
+        perfHudPoseUpdate("MOTION");
+        return armCenterY;
     }
 
-    cv::Mat inputBlob = cv::dnn::blobFromImage(frame, 1.0 / 255, cv::Size(368, 368), 
-                                                cv::Scalar(0, 0, 0), false, false);
-    net.setInput(inputBlob);
-    cv::Mat output = net.forward();
-
-    int H = output.size[2];
-    int W = output.size[3];
-
-    int leftWristIdx = 7;
-    int rightWristIdx = 4;
+    if (posePipelineActive()) {
+        TRACE_STAGE("preprocess");
+        // A frame that finds every network busy is dropped before it can
+        // become the idle detector's reference.
+        if (posePipelineReserve() && idleShouldInfer(frame)) {
+            posePipelineSubmit(framePoseBlob(frame), sessionCaptureTicks());
+        }
+        // Results arrive in capture order, possibly several in one frame or
+        // none; each goes through the filter at the time it was captured.
+        TRACE_NEXT_STAGE("postprocess");
+        PoseResult result;
+        while (posePipelineTake(result)) {
+            std::copy(result.keypoints, result.keypoints + NUM_KEYPOINTS, keypoints);
+            filterKeypoints(result.captureTicks / 1000.0);
+            perfHudPoseUpdate("PIPELINE");
+        }
+        latencyProbePose(*this);
+        return armCenterY;
+    }
 
-    cv::Mat leftWristHeatmap(H, W, CV_32F, output.ptr(0, leftWristIdx));
-    cv::Mat rightWristHeatmap(H, W, CV_32F, output.ptr(0, rightWristIdx));
+    TRACE_STAGE("preprocess");
+    // An unchanged scene gives the same keypoints; keep the last ones.
+    bool inferred = idleShouldInfer(frame);
+    if (inferred) {
+        const cv::Mat& inputBlob = framePoseBlob(frame);
+        TRACE_NEXT_STAGE("inference");
+        net.setInput(inputBlob);
+        cv::Mat output = net.forward();
+
+        TRACE_NEXT_STAGE("postprocess");
+        keypointsFromHeatmaps(output, keypoints);
+    }
+    filterKeypoints(sessionTicks() / 1000.0);
+    sessionLogPose(*this);
+    latencyProbePose(*this);
+    perfHudPoseUpdate(inferred ? "OPENPOSE" : "STILL");
+    return armCenterY;
+}
 
-    cv::Point leftMax, rightMax;
-    double leftConf, rightConf;
-    cv::minMaxLoc(leftWristHeatmap, nullptr, &leftConf, nullptr, &leftMax);
-    cv::minMaxLoc(rightWristHeatmap, nullptr, &rightConf, nullptr, &rightMax);
+// Wrist positions and the smoothed arm height from the current keypoints,
+// then the idle and gesture trackers, for a detection captured at time.
+void PoseDetector::filterKeypoints(double time) {
+    const Keypoint& leftWrist = keypoints[POSE_LEFT_WRIST];
+    const Keypoint& rightWrist = keypoints[POSE_RIGHT_WRIST];
 
     float avgY = 0.5f;
     int count = 0;
     
-    if (leftConf > 0.1) {
-        leftHandX = (float)leftMax.x / W;
-        leftHandY = (float)leftMax.y / H;
+    if (leftWrist.confidence > 0.1f) {
+        leftHandX = leftWrist.x;
+        leftHandY = leftWrist.y;
         avgY += leftHandY;
         count++;
     }
-    if (rightConf > 0.1) {
-        rightHandX = (float)rightMax.x / W;
-        rightHandY = (float)rightMax.y / H;
+    if (rightWrist.confidence > 0.1f) {
+        rightHandX = rightWrist.x;
+        rightHandY = rightWrist.y;
         avgY += rightHandY;
         count++;
     }
@@ -83,18 +132,44 @@ float PoseDetector::detectArmPosition(cv::Mat& frame) {
     }
 
     armCenterY = armCenterY * 0.7f + avgY * 0.3f;
-    return armCenterY;
+    idleReportPose(keypoints, time);
+    gestureUpdate(time, keypoints);
 }
 
 void PoseDetector::detectBothHands(cv::Mat& frame) {
+    if (sessionApplyPose(*this)) {
+        gestureUpdate(sessionTicks() / 1000.0, keypoints);
+        perfHudPoseUpdate("REPLAY");
+        return;
+    }
+    if (soakApplyPose(*this)) {
+        sessionLogPose(*this);
+        gestureUpdate(sessionTicks() / 1000.0, keypoints);
+        perfHudPoseUpdate("SCRIPT");
+        return;
+    }
     if (!initialized) {
         motionFallbackBothHands(frame);
+        keypointsFromHands();
+        sessionLogPose(*this);
+        latencyProbePose(*this);
+        gestureUpdate(sessionTicks() / 1000.0, keypoints);
+        perfHudPoseUpdate("MOTION");
         return;
     }
     detectArmPosition(frame);
 }
 
+// Motion detection only finds the hands, so the rest of the body is reported
+// as not seen.
+void PoseDetector::keypointsFromHands() {
+    for (Keypoint& k : keypoints) k = {0, 0, 0};
+    keypoints[POSE_LEFT_WRIST] = {leftHandX, leftHandY, 1.0f};
+    keypoints[POSE_RIGHT_WRIST] = {rightHandX, rightHandY, 1.0f};
+}
+
 void PoseDetector::motionFallbackBothHands(cv::Mat& frame) {
+    TRACE_SCOPE("motion_fallback");
     if (prevFrame.empty()) {
         prevFrame = frame.clone();
         return;
@@ -112,21 +187,22 @@ void PoseDetector::motionFallbackBothHands(cv::Mat& frame) {
     cv::erode(diff, diff, kernel);
     cv::dilate(diff, diff, kernel, cv::Point(-1,-1), 2);
 
-    cv::Mat leftHalf = diff(cv::Rect(0, 0, diff.cols/2, diff.rows));
-    cv::Mat rightHalf = diff(cv::Rect(diff.cols/2, 0, diff.cols/2, diff.rows));
+    // The frame is unmirrored: the left of the screen is the right of the frame.
+    cv::Mat leftHalf = diff(cv::Rect(diff.cols/2, 0, diff.cols/2, diff.rows));
+    cv::Mat rightHalf = diff(cv::Rect(0, 0, diff.cols/2, diff.rows));
 
     cv::Moments leftMom = cv::moments(leftHalf, true);
     cv::Moments rightMom = cv::moments(rightHalf, true);
 
     float minMotionArea = 800.0;
     if (leftMom.m00 > minMotionArea) {
-        float newX = (leftMom.m10 / leftMom.m00) / diff.cols;
+        float newX = 0.5f - (leftMom.m10 / leftMom.m00) / diff.cols;
         float newY = (leftMom.m01 / leftMom.m00) / diff.rows;
         leftHandX = leftHandX * 0.6f + newX * 0.4f;
         leftHandY = leftHandY * 0.6f + newY * 0.4f;
     }
     if (rightMom.m00 > minMotionArea) {
-        float newX = 0.5f + (rightMom.m10 / rightMom.m00) / diff.cols;
+        float newX = 1.0f - (rightMom.m10 / rightMom.m00) / diff.cols;
         float newY = (rightMom.m01 / rightMom.m00) / diff.rows;
         rightHandX = rightHandX * 0.6f + newX * 0.4f;
         rightHandY = rightHandY * 0.6f + newY * 0.4f;
@@ -136,6 +212,7 @@ void PoseDetector::motionFallbackBothHands(cv::Mat& frame) {
 }
 
 float PoseDetector::motionFallback(cv::Mat& frame) {
+    TRACE_SCOPE("motion_fallback");
     if (prevFrame.empty()) {
         prevFrame = frame.clone();
         return 0.5f;
@@ -163,6 +240,24 @@ float PoseDetector::motionFallback(cv::Mat& frame) {
     return armCenterY;
 }
 
+void findHeatmapPeak(cv::Mat& output, int part, cv::Point& peak, double& confidence) {
+    cv::Mat heatmap(output.size[2], output.size[3], CV_32F, output.ptr(0, part));
+    cv::minMaxLoc(heatmap, nullptr, &confidence, nullptr, &peak);
+}
+
+// Frames reach the network unmirrored, so it already names each part by the
+// player's own side; only x is mirrored.
+void keypointsFromHeatmaps(cv::Mat& output, Keypoint* keypoints) {
+    int H = output.size[2];
+    int W = output.size[3];
+    for (int part = 0; part < NUM_KEYPOINTS; part++) {
+        cv::Point peak;
+        double conf;
+        findHeatmapPeak(output, part, peak, conf);
+        keypoints[part] = {(float)(W - 1 - peak.x) / W, (float)peak.y / H, (float)conf};
+    }
+}
+
 void drawFilledCircle(SDL_Renderer* renderer, int cx, int cy, int radius) {
     for (int w = 0; w < radius * 2; w++) {
         for (int h = 0; h < radius * 2; h++) {
@@ -196,8 +291,11 @@ void drawNumber(SDL_Renderer* renderer, int number, int x, int y, int size) {
     if (number < 10) {
         drawDigit(renderer, number, x, y, size);
     } else {
-        drawDigit(renderer, number / 10, x, y, size);
-        drawDigit(renderer, number % 10, x + size + 5, y, size);
+        int divisor = 1;
+        while (number / divisor >= 10) divisor *= 10;
+        for (int cx = x; divisor > 0; divisor /= 10, cx += size + 5) {
+            drawDigit(renderer, (number / divisor) % 10, cx, y, size);
+        }
     }
 }
 
@@ -459,7 +557,8 @@ void drawInfoPopup(SDL_Renderer* renderer, int gameIndex) {
             drawText(renderer, "LEFT HAND - PUNCH LEFT TARGETS", 80, lineY, 12); lineY += lineH;
             drawText(renderer, "RIGHT HAND - PUNCH RIGHT TARGETS", 80, lineY, 12); lineY += lineH;
             drawText(renderer, "WASD - MOVE LEFT HAND (FALLBACK)", 80, lineY, 12); lineY += lineH;
-            drawText(renderer, "MOUSE - MOVE RIGHT HAND (FALLBACK)", 80, lineY, 12); lineY += lineH + 10;
+            drawText(renderer, "MOUSE - MOVE RIGHT HAND (FALLBACK)", 80, lineY, 12); lineY += lineH;
+            drawText(renderer, "M - TOGGLE SWARM MODE", 80, lineY, 12); lineY += lineH + 10;
             drawText(renderer, "HOW TO PLAY:", 80, lineY, 14); lineY += lineH + 5;
             drawText(renderer, "PUNCH TARGETS AS THEY APPEAR.", 80, lineY, 12); lineY += lineH;
             drawText(renderer, "SCORE POINTS FOR EACH HIT.", 80, lineY, 12);
@@ -504,25 +603,22 @@ void drawCameraFeed(SDL_Renderer* renderer, cv::Mat& frame, bool useCamera) {
     SDL_Rect camArea = {GAME_WIDTH, 0, CAM_WIDTH, CAM_HEIGHT};
     SDL_RenderFillRect(renderer, &camArea);
 
-    if (!frame.empty()) {
-        cv::Mat resized;
-        cv::resize(frame, resized, cv::Size(CAM_WIDTH, CAM_HEIGHT));
-        cv::cvtColor(resized, resized, cv::COLOR_BGR2RGB);
-
-        SDL_Surface* surface = SDL_CreateRGBSurfaceFrom(
-            resized.data, CAM_WIDTH, CAM_HEIGHT, 24, resized.step,
-            0x0000FF, 0x00FF00, 0xFF0000, 0
-        );
-        
-        if (surface) {
-            SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-            if (texture) {
-                SDL_Rect destRect = {GAME_WIDTH, 0, CAM_WIDTH, CAM_HEIGHT};
-                SDL_RenderCopy(renderer, texture, nullptr, &destRect);
-                SDL_DestroyTexture(texture);
-            }
-            SDL_FreeSurface(surface);
-        }
+    // One streaming texture per renderer; the preview is uploaded in the
+    // camera's BGR byte order and mirrored by the copy.
+    static SDL_Renderer* previewRenderer = nullptr;
+    static SDL_Texture* previewTexture = nullptr;
+    if (!frame.empty() && renderer != previewRenderer) {
+        if (previewTexture) SDL_DestroyTexture(previewTexture);
+        previewTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_BGR24, SDL_TEXTUREACCESS_STREAMING,
+                                           CAM_WIDTH, CAM_HEIGHT);
+        previewRenderer = renderer;
+    }
+
+    const cv::Mat* preview = frame.empty() ? nullptr : &framePreview(frame);
+    if (preview && !preview->empty() && previewTexture) {
+        SDL_UpdateTexture(previewTexture, nullptr, preview->data, (int)preview->step);
+        SDL_Rect destRect = {GAME_WIDTH, 0, CAM_WIDTH, CAM_HEIGHT};
+        SDL_RenderCopyEx(renderer, previewTexture, nullptr, &destRect, 0, nullptr, SDL_FLIP_HORIZONTAL);
     } else {
         SDL_SetRenderDrawColor(renderer, 100, 100, 100, 255);
         int cx = GAME_WIDTH + CAM_WIDTH / 2;
@@ -541,6 +637,7 @@ void drawCameraFeed(SDL_Renderer* renderer, cv::Mat& frame, bool useCamera) {
     SDL_SetRenderDrawColor(renderer, 40, 40, 40, 255);
     SDL_Rect infoArea = {GAME_WIDTH, CAM_HEIGHT, CAM_WIDTH, GAME_HEIGHT - CAM_HEIGHT};
     SDL_RenderFillRect(renderer, &infoArea);
+    drawPerfHud(renderer, infoArea.x, infoArea.y, infoArea.w, infoArea.h);
     
     if (useCamera) {
         SDL_SetRenderDrawColor(renderer, 0, 200, 0, 255);
@@ -549,3 +646,17 @@ void drawCameraFeed(SDL_Renderer* renderer, cv::Mat& frame, bool useCamera) {
     }
     drawFilledCircle(renderer, GAME_WIDTH + CAM_WIDTH - 30, CAM_HEIGHT + 30, 8);
 }
+
+void writeJsonEscaped(std::ostream& out, const std::string& s) {
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if ((unsigned char)c < 0x20) {
+            char hex[8];
+            std::snprintf(hex, sizeof(hex), "\\u%04x", c);
+            out << hex;
+        } else {
+            out << c;
+        }
+    }
+}
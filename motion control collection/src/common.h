@@ -10,6 +10,7 @@
 #include <vector>
 #include <cmath>
 #include <random>
+#include <string>
 #include <algorithm>
 
 const int GAME_WIDTH = 800;
@@ -17,6 +18,7 @@ const int GAME_HEIGHT = 600;
 const int CAM_WIDTH = 320;
 const int CAM_HEIGHT = 240;
 const int WINDOW_WIDTH = GAME_WIDTH + CAM_WIDTH;
+const int POSE_INPUT_SIZE = 368;
 
 struct Color {
     Uint8 r, g, b, a;
@@ -45,6 +47,25 @@ enum GameState {
     RHYTHM_DANCE
 };
 
+// COCO body parts, in the order of the OpenPose heatmaps. Sides are the
+// player's own, and keypoints are in the mirrored image the player sees, so
+// POSE_LEFT_* parts are on the left of the screen. The network, the motion
+// fallback, the pose vocabulary and the soak script all follow this.
+enum BodyPart {
+    POSE_NOSE, POSE_NECK,
+    POSE_RIGHT_SHOULDER, POSE_RIGHT_ELBOW, POSE_RIGHT_WRIST,
+    POSE_LEFT_SHOULDER, POSE_LEFT_ELBOW, POSE_LEFT_WRIST,
+    POSE_RIGHT_HIP, POSE_RIGHT_KNEE, POSE_RIGHT_ANKLE,
+    POSE_LEFT_HIP, POSE_LEFT_KNEE, POSE_LEFT_ANKLE,
+    POSE_RIGHT_EYE, POSE_LEFT_EYE, POSE_RIGHT_EAR, POSE_LEFT_EAR,
+    NUM_KEYPOINTS
+};
+
+struct Keypoint {
+    float x, y;
+    float confidence;
+};
+
 class PoseDetector {
 public:
     cv::dnn::Net net;
@@ -52,15 +73,21 @@ public:
     float armCenterY = 0.5f;
     float leftHandX = 0.3f, leftHandY = 0.5f;
     float rightHandX = 0.7f, rightHandY = 0.5f;
+    Keypoint keypoints[NUM_KEYPOINTS] = {};
     cv::Mat prevFrame;
 
     bool init();
+    void keypointsFromHands();
+    void filterKeypoints(double time);
     float detectArmPosition(cv::Mat& frame);
     void detectBothHands(cv::Mat& frame);
     void motionFallbackBothHands(cv::Mat& frame);
     float motionFallback(cv::Mat& frame);
 };
 
+void findHeatmapPeak(cv::Mat& output, int part, cv::Point& peak, double& confidence);
+// Peak of every part's heatmap, with x mirrored like PoseDetector::keypoints.
+void keypointsFromHeatmaps(cv::Mat& output, Keypoint* keypoints);
 void drawFilledCircle(SDL_Renderer* renderer, int cx, int cy, int radius);
 void drawDigit(SDL_Renderer* renderer, int digit, int x, int y, int size);
 void drawNumber(SDL_Renderer* renderer, int number, int x, int y, int size);
@@ -69,4 +96,7 @@ void drawText(SDL_Renderer* renderer, const char* text, int x, int y, int size);
 void drawCameraFeed(SDL_Renderer* renderer, cv::Mat& frame, bool useCamera);
 void drawInfoPopup(SDL_Renderer* renderer, int gameIndex);
 
+// Writes s as the contents of a JSON string, for user-supplied names and paths.
+void writeJsonEscaped(std::ostream& out, const std::string& s);
+
 #endif
@@ -0,0 +1,87 @@
+#include "frame_prep.h"
+
+static const int POSE_STRIDE = 8;
+
+static const uchar* preparedData = nullptr;
+static cv::Size preparedSize;
+static cv::Mat small;
+static cv::Mat blob;
+static cv::Mat preview;
+static cv::Mat thumbnail;
+static bool blobReady = false;
+static bool previewReady = false;
+static bool thumbnailReady = false;
+
+cv::Size framePoseInputSize(const cv::Size& frameSize) {
+    if (frameSize.width <= 0 || frameSize.height <= 0) return cv::Size(POSE_INPUT_SIZE, POSE_INPUT_SIZE);
+    int longSide = std::max(frameSize.width, frameSize.height);
+    int shortSide = std::min(frameSize.width, frameSize.height);
+    int scaled = (int)std::ceil((double)shortSide * POSE_INPUT_SIZE / longSide / POSE_STRIDE) * POSE_STRIDE;
+    scaled = std::max(POSE_STRIDE, std::min(POSE_INPUT_SIZE, scaled));
+    return frameSize.width >= frameSize.height ? cv::Size(POSE_INPUT_SIZE, scaled) : cv::Size(scaled, POSE_INPUT_SIZE);
+}
+
+void framePrepare(const cv::Mat& frame) {
+    preparedData = frame.data;
+    preparedSize = frame.size();
+    blobReady = false;
+    previewReady = false;
+    thumbnailReady = false;
+    if (frame.empty()) {
+        small.release();
+        blob.release();
+        preview.release();
+        thumbnail.release();
+        return;
+    }
+    cv::resize(frame, small, framePoseInputSize(frame.size()), 0, 0, cv::INTER_LINEAR);
+}
+
+static void ensurePrepared(const cv::Mat& frame) {
+    if (frame.data != preparedData || frame.size() != preparedSize) framePrepare(frame);
+}
+
+// Splits the interleaved pixels into the three planes of the blob and scales
+// them in the same loop.
+const cv::Mat& framePoseBlob(const cv::Mat& frame) {
+    ensurePrepared(frame);
+    if (blobReady || small.empty()) return blob;
+
+    int shape[] = {1, 3, small.rows, small.cols};
+    blob.create(4, shape, CV_32F);
+    size_t planeSize = (size_t)small.rows * small.cols;
+    float* b = blob.ptr<float>();
+    float* g = b + planeSize;
+    float* r = g + planeSize;
+    const float scale = 1.0f / 255;
+    for (int y = 0; y < small.rows; y++) {
+        const uchar* src = small.ptr<uchar>(y);
+        size_t row = (size_t)y * small.cols;
+        for (int x = 0; x < small.cols; x++) {
+            b[row + x] = src[x * 3] * scale;
+            g[row + x] = src[x * 3 + 1] * scale;
+            r[row + x] = src[x * 3 + 2] * scale;
+        }
+    }
+    blobReady = true;
+    return blob;
+}
+
+const cv::Mat& framePreview(const cv::Mat& frame) {
+    ensurePrepared(frame);
+    if (previewReady || small.empty()) return preview;
+    cv::resize(small, preview, cv::Size(CAM_WIDTH, CAM_HEIGHT), 0, 0, cv::INTER_AREA);
+    previewReady = true;
+    return preview;
+}
+
+const cv::Mat& frameThumbnail(const cv::Mat& frame) {
+    ensurePrepared(frame);
+    if (thumbnailReady || small.empty()) return thumbnail;
+    cv::Mat reduced;
+    cv::resize(small, reduced, cv::Size(std::max(1, small.cols / FRAME_THUMBNAIL_SCALE),
+                                        std::max(1, small.rows / FRAME_THUMBNAIL_SCALE)), 0, 0, cv::INTER_AREA);
+    cv::cvtColor(reduced, thumbnail, cv::COLOR_BGR2GRAY);
+    thumbnailReady = true;
+    return thumbnail;
+}
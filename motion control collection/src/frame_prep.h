@@ -0,0 +1,28 @@
+#ifndef FRAME_PREP_H
+#define FRAME_PREP_H
+
+#include "common.h"
+
+// Camera frames are read once per capture: a single resize brings the frame
+// to the pose input size, and both the network blob and the camera preview
+// are made from that small copy when first asked for. Frames are never
+// mirrored in memory. The pose detector mirrors keypoint coordinates instead
+// and the preview is flipped when it is drawn.
+void framePrepare(const cv::Mat& frame);
+
+// Pose input size for a frame: the longer side is POSE_INPUT_SIZE and the
+// shorter side keeps the aspect ratio, rounded up to the network stride.
+cv::Size framePoseInputSize(const cv::Size& frameSize);
+
+// 1x3xHxW float blob (BGR, scaled to 0..1) and CAM_WIDTH x CAM_HEIGHT BGR
+// preview of the frame, both unmirrored. A frame that was not the last one
+// prepared is prepared first.
+const cv::Mat& framePoseBlob(const cv::Mat& frame);
+const cv::Mat& framePreview(const cv::Mat& frame);
+
+// Grayscale thumbnail at 1/FRAME_THUMBNAIL_SCALE of the pose input size, for
+// cheap scene-change tests.
+const int FRAME_THUMBNAIL_SCALE = 8;
+const cv::Mat& frameThumbnail(const cv::Mat& frame);
+
+#endif
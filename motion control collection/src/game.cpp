@@ -0,0 +1,196 @@
+#include "game.h"
+#include "pickleball_game.h"
+#include "boxing_game.h"
+#include "tennis_game.h"
+#include "archery_game.h"
+#include "rhythm_dance_game.h"
+#include "session.h"
+#include "trace.h"
+#include "latency_probe.h"
+#include "soak.h"
+#include "video_record.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+const std::vector<GameRegistration>& gameRegistry() {
+    static const std::vector<GameRegistration> games = {
+        {PICKLEBALL, "pickleball", createPickleball},
+        {BOXING, "boxing", createBoxing},
+        {TENNIS, "tennis", createTennis},
+        {ARCHERY, "archery", createArchery},
+        {RHYTHM_DANCE, "rhythm_dance", createRhythmDance},
+    };
+    return games;
+}
+
+const GameRegistration* gameFind(GameState state) {
+    for (const GameRegistration& game : gameRegistry()) {
+        if (game.state == state) return &game;
+    }
+    return nullptr;
+}
+
+// Runs Game::update() on its own thread, one tick per start().
+class SimulationThread {
+public:
+    explicit SimulationThread(Game& game) : game(game), thread(&SimulationThread::run, this) {}
+
+    ~SimulationThread() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        thread.join();
+    }
+
+    void start(float dt, const GameInput& input) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tickDt = dt;
+            tickInput = &input;
+            busy = true;
+        }
+        wake.notify_one();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return !busy; });
+    }
+
+private:
+    Game& game;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    float tickDt = 0;
+    const GameInput* tickInput = nullptr;
+    bool busy = false;
+    bool stopping = false;
+    std::thread thread;
+
+    void run() {
+        traceSetThreadName("simulation");
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this] { return busy || stopping; });
+            if (stopping) return;
+            lock.unlock();
+            {
+                TRACE_SCOPE("update");
+                game.update(tickDt, *tickInput);
+            }
+            lock.lock();
+            busy = false;
+            done.notify_one();
+        }
+    }
+};
+
+static void copyPose(const PoseDetector& poseDetector, GamePose& pose) {
+    pose.armY = poseDetector.armCenterY;
+    pose.leftHandX = poseDetector.leftHandX;
+    pose.leftHandY = poseDetector.leftHandY;
+    pose.rightHandX = poseDetector.rightHandX;
+    pose.rightHandY = poseDetector.rightHandY;
+    std::copy(poseDetector.keypoints, poseDetector.keypoints + NUM_KEYPOINTS, pose.keypoints);
+    pose.drawAmount = gestureDrawAmount();
+}
+
+static void detectPose(Game& game, PoseDetector& poseDetector, cv::Mat& frame, GamePose& pose) {
+    if (game.poseMode() == POSE_ARM) {
+        poseDetector.detectArmPosition(frame);
+    } else {
+        poseDetector.detectBothHands(frame);
+    }
+    copyPose(poseDetector, pose);
+}
+
+bool gameRun(Game& game, SDL_Renderer* renderer, PoseDetector& poseDetector, CaptureSource& cap,
+             bool useCamera, cv::Mat& currentFrame) {
+    // Gestures are dispatched from inside the detector call on this thread;
+    // they are queued here and handed to the tick with the rest of the input.
+    std::vector<GestureEvent> gestures;
+    std::vector<int> subscriptions;
+    gestureReset();
+    for (int type = 0; type < NUM_GESTURES; type++) {
+        subscriptions.push_back(gestureSubscribe((GestureType)type, [&](const GestureEvent& event) {
+            gestures.push_back(event);
+        }));
+    }
+
+    game.onEnter();
+
+    GameInput input;
+    input.useCamera = useCamera;
+    copyPose(poseDetector, input.pose);
+    bool returnToMenu = false;
+    bool running = true;
+    {
+        SimulationThread simulation(game);
+        while (running) {
+            TRACE_SCOPE("frame");
+            TRACE_STAGE("events");
+            sessionBeginFrame();
+            input.time = sessionTicks() / 1000.0;
+            input.musicTime = sessionMusicTime();
+            input.events.clear();
+            if (soakScripted()) soakPushEvents();
+            SDL_Event event;
+            while (sessionPollEvent(&event)) {
+                if (event.type == SDL_QUIT) {
+                    running = false;
+                } else if (event.type == SDL_KEYDOWN &&
+                           (event.key.keysym.sym == SDLK_ESCAPE || event.key.keysym.sym == SDLK_q)) {
+                    returnToMenu = true;
+                    running = false;
+                } else if (event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) {
+                    input.events.push_back(event);
+                }
+            }
+            if (!running) break;
+
+            TRACE_NEXT_STAGE("input");
+            const Uint8* keys = sessionKeyboardState();
+            std::copy(keys, keys + SDL_NUM_SCANCODES, input.keys);
+            sessionMouseState(&input.mouseX, &input.mouseY);
+            input.pose.detected = useCamera && sessionCaptureFrame(cap, currentFrame);
+            if (input.pose.detected) detectPose(game, poseDetector, currentFrame, input.pose);
+            input.pose.gestures.swap(gestures);
+            gestures.clear();
+
+            simulation.start(GAME_TICK_SECONDS, input);
+            TRACE_NEXT_STAGE("draw");
+            game.render(renderer);
+            drawCameraFeed(renderer, currentFrame, useCamera);
+            TRACE_NEXT_STAGE("simulation");
+            simulation.wait();
+            game.publish();
+            TRACE_NEXT_STAGE("present");
+            videoRecordFrame(renderer);
+            if (soakPresents()) {
+                SDL_RenderPresent(renderer);
+            } else {
+                // Without a present the renderer's command queue would only grow.
+                SDL_RenderFlush(renderer);
+            }
+            // This present shows the state published last tick; the pose read
+            // this frame reaches the screen with the next one.
+            latencyProbePresented(1);
+            if (soakActive()) {
+                if (!soakFrameDone()) {
+                    returnToMenu = true;
+                    running = false;
+                }
+            } else {
+                TRACE_NEXT_STAGE("sleep");
+                SDL_Delay(16);
+            }
+        }
+    }
+
+    game.onExit();
+    for (int id : subscriptions) gestureUnsubscribe(id);
+    return returnToMenu;
+}
@@ -0,0 +1,157 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include "common.h"
+#include "gesture.h"
+#include <memory>
+
+class CaptureSource;
+
+// Games are driven by one shared runner. Each frame the main thread polls
+// events, reads the camera and runs pose inference into a GameInput, then
+// hands it to the simulation thread, which advances the game one tick while
+// the main thread renders the state the previous tick published. When both
+// are done the new state is published and the frame is presented, so SDL
+// drawing overlaps the next tick's physics at the cost of showing each tick
+// one frame later.
+const float GAME_TICK_SECONDS = 0.016f;
+
+enum PoseMode {
+    POSE_ARM,           // detectArmPosition: one arm height
+    POSE_BOTH_HANDS     // detectBothHands: both hand positions
+};
+
+// Detector output as of the last camera frame. detected is set only when this
+// frame read one; the gestures are the ones recognised from it.
+struct GamePose {
+    bool detected = false;
+    float armY = 0.5f;
+    float leftHandX = 0.3f, leftHandY = 0.5f;
+    float rightHandX = 0.7f, rightHandY = 0.5f;
+    Keypoint keypoints[NUM_KEYPOINTS] = {};
+    float drawAmount = 0;
+    std::vector<GestureEvent> gestures;
+};
+
+struct GameInput {
+    double time = 0;                 // session time in seconds
+    double musicTime = -1;           // song position in seconds, -1 without music
+    bool useCamera = false;
+    std::vector<SDL_Event> events;   // key events; quitting and leaving the game are handled by the runner
+    Uint8 keys[SDL_NUM_SCANCODES] = {};
+    int mouseX = 0, mouseY = 0;
+    GamePose pose;
+};
+
+class Game {
+public:
+    virtual ~Game() {}
+
+    // Main thread, before the first tick and after the last one. Music and
+    // other audio device changes belong here.
+    virtual void onEnter() {}
+    virtual void onExit() {}
+
+    virtual PoseMode poseMode() const { return POSE_BOTH_HANDS; }
+
+    // Simulation thread: advances the back state by one tick. May play sound
+    // effects but must not touch the renderer.
+    virtual void update(float dt, const GameInput& input) = 0;
+
+    // Main thread, concurrently with update(): draws the front state.
+    virtual void render(SDL_Renderer* renderer) = 0;
+
+    // Main thread, with neither of the above running: makes the state the
+    // last update() produced the front state.
+    virtual void publish() = 0;
+};
+
+// A game's simulation state, kept twice so update() and render() never touch
+// the same copy. publish() swaps the two and copies the new front into the
+// back, so the next tick continues from it. That copy runs every tick, so
+// pools and histories in a state copy only their live items into storage
+// they already have (see FixedRing) instead of allocating.
+template <typename State>
+class DoubleBuffer {
+public:
+    explicit DoubleBuffer(const State& initial) {
+        states[0] = initial;
+        states[1] = initial;
+    }
+
+    State& back() { return states[1 - current]; }
+    State& front() { return states[current]; }
+
+    void publish() {
+        current = 1 - current;
+        states[1 - current] = states[current];
+    }
+
+private:
+    State states[2];
+    int current = 0;
+};
+
+// Bounded FIFO for double-buffered state. Storage is allocated once, a push
+// onto a full ring drops the oldest item, and assignment copies only the
+// live items into the existing storage, so publish() never allocates.
+template <typename T, size_t N>
+class FixedRing {
+public:
+    FixedRing() : items(N) {}
+    FixedRing(const FixedRing& other) : items(N) { *this = other; }
+
+    FixedRing& operator=(const FixedRing& other) {
+        first = 0;
+        count = other.count;
+        for (size_t i = 0; i < count; i++) items[i] = other[i];
+        return *this;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T& operator[](size_t i) { return items[(first + i) % N]; }
+    const T& operator[](size_t i) const { return items[(first + i) % N]; }
+    T& front() { return (*this)[0]; }
+    const T& front() const { return (*this)[0]; }
+    T& back() { return (*this)[count - 1]; }
+    const T& back() const { return (*this)[count - 1]; }
+
+    void push_back(const T& item) {
+        if (count == N) pop_front();
+        items[(first + count) % N] = item;
+        count++;
+    }
+    void pop_front() {
+        first = (first + 1) % N;
+        count--;
+    }
+    void clear() {
+        first = 0;
+        count = 0;
+    }
+
+private:
+    std::vector<T> items;
+    size_t first = 0;
+    size_t count = 0;
+};
+
+typedef std::unique_ptr<Game> (*GameFactory)(Mix_Music* menuMusic);
+
+struct GameRegistration {
+    GameState state;
+    const char* name;
+    GameFactory create;
+};
+
+// Every game, in menu order.
+const std::vector<GameRegistration>& gameRegistry();
+const GameRegistration* gameFind(GameState state);
+
+// Runs a game until the window is closed or the player leaves it. Returns
+// true when the player asked to go back to the menu.
+bool gameRun(Game& game, SDL_Renderer* renderer, PoseDetector& poseDetector, CaptureSource& cap,
+             bool useCamera, cv::Mat& currentFrame);
+
+#endif
@@ -0,0 +1,242 @@
+#include "gesture.h"
+#include "trace.h"
+
+static const float MIN_CONFIDENCE = 0.1f;
+static const float IMAGE_TORSO_LENGTH = 0.3f;
+static const double FILTER_TIME = 0.03;
+static const double MAX_GAP = 0.25;
+
+static const float PUNCH_SPEED = 3.0f;
+static const float PUNCH_REARM_SPEED = 1.0f;
+static const double PUNCH_PEAK_WAIT = 0.06;
+
+static const float SWING_SPEED = 2.0f;
+static const float SWING_STOP_SPEED = 0.5f;
+static const double SWING_REFRACTORY = 0.2;
+
+static const float DRAW_START_DISTANCE = 0.15f;
+static const float DRAW_SPEED = 0.5f;
+static const float DRAW_FULL = 0.8f;
+static const float DRAW_MIN_AMOUNT = 0.2f;
+static const double DRAW_SETTLE = 1.0;
+static const float RELEASE_SPEED = 1.5f;
+
+struct WristTrack {
+    bool seen = false;
+    double time = 0;
+    float x = 0, y = 0;
+    float vx = 0, vy = 0;
+    float ax = 0, ay = 0;
+
+    bool punchArmed = true;
+    bool punching = false;
+    double punchStart = 0;
+    float punchPeak = 0;
+
+    bool swinging = false;
+    double swingEnd = -1e9;
+    float swingDirX = 0, swingDirY = 0;
+    float swingPeak = 0;
+};
+
+struct DrawTrack {
+    bool seen = false;
+    double time = 0;
+    float separation = 0;
+    float rate = 0;
+    float base = 0;
+    bool drawing = false;
+    float amount = 0;
+    float peak = 0;
+};
+
+struct Subscription {
+    int id;
+    GestureType type;
+    GestureHandler handler;
+};
+
+static std::vector<Subscription> subscriptions;
+static int nextSubscription = 1;
+static WristTrack wrists[2];
+static DrawTrack draw;
+static float bodyScale = IMAGE_TORSO_LENGTH;
+
+int gestureSubscribe(GestureType type, GestureHandler handler) {
+    subscriptions.push_back({nextSubscription, type, handler});
+    return nextSubscription++;
+}
+
+void gestureUnsubscribe(int id) {
+    subscriptions.erase(std::remove_if(subscriptions.begin(), subscriptions.end(),
+        [id](const Subscription& s) { return s.id == id; }), subscriptions.end());
+}
+
+void gestureReset() {
+    wrists[0] = WristTrack();
+    wrists[1] = WristTrack();
+    draw = DrawTrack();
+    bodyScale = IMAGE_TORSO_LENGTH;
+}
+
+float gestureDrawAmount() {
+    return draw.drawing ? draw.amount : 0.0f;
+}
+
+static void emit(GestureType type, int part, double time, float x, float y, float speed, float amount) {
+    GestureEvent event = {type, part, time, x, y, speed, amount};
+    for (const Subscription& s : subscriptions) {
+        if (s.type == type) s.handler(event);
+    }
+}
+
+static bool seen(const Keypoint& k) {
+    return k.confidence > MIN_CONFIDENCE;
+}
+
+static float smoothing(double dt) {
+    return (float)(1.0 - std::exp(-dt / FILTER_TIME));
+}
+
+// A punch starts when the wrist passes PUNCH_SPEED moving away from its
+// shoulder and is reported at its peak speed, once the wrist starts slowing
+// down. It re-arms when the hand has come almost to rest.
+static void detectPunch(WristTrack& w, int part, const Keypoint* keypoints, float speed) {
+    if (w.punching) {
+        w.punchPeak = std::max(w.punchPeak, speed);
+        bool slowing = w.ax * w.vx + w.ay * w.vy < 0;
+        if (slowing || w.time - w.punchStart >= PUNCH_PEAK_WAIT) {
+            emit(GESTURE_PUNCH, part, w.time, w.x, w.y, w.punchPeak, 0);
+            w.punching = false;
+            w.punchArmed = false;
+        }
+    } else if (!w.punchArmed) {
+        w.punchArmed = speed < PUNCH_REARM_SPEED;
+    } else if (speed > PUNCH_SPEED) {
+        const Keypoint& shoulder = keypoints[part == POSE_LEFT_WRIST ? POSE_LEFT_SHOULDER : POSE_RIGHT_SHOULDER];
+        bool extending = !seen(shoulder) || w.vx * (w.x - shoulder.x) + w.vy * (w.y - shoulder.y) > 0;
+        if (extending) {
+            w.punching = true;
+            w.punchStart = w.time;
+            w.punchPeak = speed;
+        }
+    }
+}
+
+// A swing runs from the wrist passing SWING_SPEED to the apex where it stops
+// or turns back against its starting direction.
+static void detectSwing(WristTrack& w, int part, float speed) {
+    if (w.swinging) {
+        w.swingPeak = std::max(w.swingPeak, speed);
+        if (speed < SWING_STOP_SPEED || w.vx * w.swingDirX + w.vy * w.swingDirY <= 0) {
+            emit(GESTURE_SWING_APEX, part, w.time, w.x, w.y, w.swingPeak, 0);
+            w.swinging = false;
+            w.swingEnd = w.time;
+        }
+    } else if (speed > SWING_SPEED && w.time - w.swingEnd >= SWING_REFRACTORY) {
+        w.swinging = true;
+        w.swingDirX = w.vx / speed;
+        w.swingDirY = w.vy / speed;
+        w.swingPeak = speed;
+        emit(GESTURE_SWING_START, part, w.time, w.x, w.y, speed, 0);
+    }
+}
+
+static void updateWrist(WristTrack& w, int part, double time, const Keypoint* keypoints) {
+    const Keypoint& k = keypoints[part];
+    if (!seen(k)) {
+        w = WristTrack();
+        return;
+    }
+    if (!w.seen || time - w.time > MAX_GAP) {
+        w = WristTrack();
+        w.seen = true;
+        w.time = time;
+        w.x = k.x;
+        w.y = k.y;
+        return;
+    }
+    double dt = time - w.time;
+    if (dt <= 0) return;
+
+    float alpha = smoothing(dt);
+    float vx = w.vx + ((k.x - w.x) / bodyScale / (float)dt - w.vx) * alpha;
+    float vy = w.vy + ((k.y - w.y) / bodyScale / (float)dt - w.vy) * alpha;
+    w.ax += ((vx - w.vx) / (float)dt - w.ax) * alpha;
+    w.ay += ((vy - w.vy) / (float)dt - w.ay) * alpha;
+    w.vx = vx;
+    w.vy = vy;
+    w.x = k.x;
+    w.y = k.y;
+    w.time = time;
+
+    float speed = std::sqrt(vx * vx + vy * vy);
+    detectPunch(w, part, keypoints, speed);
+    detectSwing(w, part, speed);
+}
+
+// The bow is drawn by pulling the hands apart and released by bringing them
+// together again. The start of a draw is measured from a baseline that
+// settles on the resting hand separation over DRAW_SETTLE.
+static void updateDraw(double time, const Keypoint& left, const Keypoint& right) {
+    if (!seen(left) || !seen(right)) {
+        draw = DrawTrack();
+        return;
+    }
+    float dx = left.x - right.x;
+    float dy = left.y - right.y;
+    float separation = std::sqrt(dx * dx + dy * dy) / bodyScale;
+    if (!draw.seen || time - draw.time > MAX_GAP) {
+        draw = DrawTrack();
+        draw.seen = true;
+        draw.time = time;
+        draw.separation = separation;
+        draw.base = separation;
+        return;
+    }
+    double dt = time - draw.time;
+    if (dt <= 0) return;
+
+    draw.rate += ((separation - draw.separation) / (float)dt - draw.rate) * smoothing(dt);
+    draw.separation = separation;
+    draw.time = time;
+    float midX = (left.x + right.x) / 2;
+    float midY = (left.y + right.y) / 2;
+
+    if (draw.drawing) {
+        draw.amount = std::max(0.0f, std::min(1.0f, (separation - draw.base) / DRAW_FULL));
+        if (draw.rate < -RELEASE_SPEED) {
+            if (draw.peak >= DRAW_MIN_AMOUNT) {
+                emit(GESTURE_RELEASE, -1, time, midX, midY, -draw.rate, draw.peak);
+            }
+            draw.drawing = false;
+            draw.amount = 0;
+            draw.base = separation;
+        } else {
+            draw.peak = std::max(draw.peak, draw.amount);
+        }
+    } else {
+        float settle = (float)(1.0 - std::exp(-dt / DRAW_SETTLE));
+        draw.base = std::min(separation, draw.base + (separation - draw.base) * settle);
+        if (separation - draw.base > DRAW_START_DISTANCE && draw.rate > DRAW_SPEED) {
+            draw.drawing = true;
+            draw.amount = std::min(1.0f, (separation - draw.base) / DRAW_FULL);
+            draw.peak = draw.amount;
+            emit(GESTURE_DRAW_START, -1, time, midX, midY, draw.rate, draw.amount);
+        }
+    }
+}
+
+void gestureUpdate(double time, const Keypoint* keypoints) {
+    TRACE_SCOPE("gestures");
+    const Keypoint& neck = keypoints[POSE_NECK];
+    const Keypoint& hip = seen(keypoints[POSE_RIGHT_HIP]) ? keypoints[POSE_RIGHT_HIP] : keypoints[POSE_LEFT_HIP];
+    if (seen(neck) && seen(hip)) {
+        float torso = std::sqrt((hip.x - neck.x) * (hip.x - neck.x) + (hip.y - neck.y) * (hip.y - neck.y));
+        if (torso > 0.01f) bodyScale += (torso - bodyScale) * 0.1f;
+    }
+
+    updateWrist(wrists[0], POSE_LEFT_WRIST, time, keypoints);
+    updateWrist(wrists[1], POSE_RIGHT_WRIST, time, keypoints);
+    updateDraw(time, keypoints[POSE_LEFT_WRIST], keypoints[POSE_RIGHT_WRIST]);
+}
@@ -0,0 +1,47 @@
+#ifndef GESTURE_H
+#define GESTURE_H
+
+#include "common.h"
+#include <functional>
+
+// Discrete gestures recognised from the keypoint stream. The pose detector
+// feeds every detection in with its session time; wrist velocity and
+// acceleration are filtered incrementally and events are dispatched to the
+// subscribers from inside that call, so a game sees them in the same frame's
+// input stage. Speeds and distances are in torso lengths (per second), which
+// keeps the thresholds independent of how far the player stands from the
+// camera. An event fires at most GESTURE_MAX_LATENCY after the motion that
+// triggered it.
+enum GestureType {
+    GESTURE_PUNCH,
+    GESTURE_SWING_START,
+    GESTURE_SWING_APEX,
+    GESTURE_DRAW_START,
+    GESTURE_RELEASE,
+    NUM_GESTURES
+};
+
+const float GESTURE_MAX_LATENCY = 0.1f;
+
+struct GestureEvent {
+    GestureType type;
+    int part;       // POSE_LEFT_WRIST or POSE_RIGHT_WRIST, -1 for two-handed gestures
+    double time;
+    float x, y;     // image coordinates of the wrist (midpoint for two-handed gestures)
+    float speed;    // peak speed of the motion
+    float amount;   // how far a bow was drawn, 0..1
+};
+
+typedef std::function<void(const GestureEvent&)> GestureHandler;
+
+// Handlers must not subscribe or unsubscribe from inside a dispatch.
+int gestureSubscribe(GestureType type, GestureHandler handler);
+void gestureUnsubscribe(int id);
+
+void gestureReset();
+void gestureUpdate(double time, const Keypoint* keypoints);
+
+// Current draw of the bow, 0 when not drawing.
+float gestureDrawAmount();
+
+#endif
@@ -0,0 +1,106 @@
+#include "idle_detector.h"
+#include "frame_prep.h"
+
+static bool enabled = true;
+static cv::Mat previousThumbnail;
+static cv::Mat inferredThumbnail;
+static bool started = false;
+static double lastActivity = 0;
+static double lastPoll = -1;
+static bool resting = false;
+
+static long framesObserved = 0;
+static long framesPolled = 0;
+static long inferencesRun = 0;
+static long inferencesSkipped = 0;
+
+static bool sceneChanged(const cv::Mat& a, const cv::Mat& b) {
+    if (a.empty() || b.empty() || a.size() != b.size()) return true;
+    int changed = 0;
+    int limit = (int)(IDLE_CHANGED_FRACTION * a.total());
+    for (int y = 0; y < a.rows; y++) {
+        const uchar* pa = a.ptr<uchar>(y);
+        const uchar* pb = b.ptr<uchar>(y);
+        for (int x = 0; x < a.cols; x++) {
+            if (std::abs(pa[x] - pb[x]) > IDLE_PIXEL_DELTA && ++changed > limit) return true;
+        }
+    }
+    return false;
+}
+
+static void setResting(bool rest) {
+    if (rest == resting) return;
+    resting = rest;
+    if (resting) {
+        std::cout << "Nobody in view. Reading the camera every " << (int)(IDLE_POLL_SECONDS * 1000) << " ms." << std::endl;
+    } else {
+        std::cout << "Motion detected. Back to full rate." << std::endl;
+    }
+}
+
+void idleSetEnabled(bool on) {
+    enabled = on;
+    setResting(false);
+}
+
+bool idleEnabled() {
+    return enabled;
+}
+
+bool idleShouldCapture(double time) {
+    if (!enabled) return true;
+    if (!started) {
+        lastActivity = time;
+        started = true;
+    }
+    setResting(time - lastActivity > IDLE_AFTER_SECONDS);
+    if (!resting) return true;
+    if (lastPoll >= 0 && time - lastPoll < IDLE_POLL_SECONDS) return false;
+    lastPoll = time;
+    framesPolled++;
+    return true;
+}
+
+void idleObserveFrame(const cv::Mat& frame, double time) {
+    if (!enabled) return;
+    framesObserved++;
+    const cv::Mat& thumbnail = frameThumbnail(frame);
+    if (sceneChanged(thumbnail, previousThumbnail)) {
+        lastActivity = time;
+        setResting(false);
+    }
+    thumbnail.copyTo(previousThumbnail);
+}
+
+bool idleShouldInfer(const cv::Mat& frame) {
+    if (!enabled) return true;
+    const cv::Mat& thumbnail = frameThumbnail(frame);
+    if (!sceneChanged(thumbnail, inferredThumbnail)) {
+        inferencesSkipped++;
+        return false;
+    }
+    thumbnail.copyTo(inferredThumbnail);
+    inferencesRun++;
+    return true;
+}
+
+void idleReportPose(const Keypoint* keypoints, double time) {
+    if (!enabled) return;
+    int seen = 0;
+    for (int i = 0; i < NUM_KEYPOINTS; i++) {
+        if (keypoints[i].confidence > 0.1f) seen++;
+    }
+    if (seen >= IDLE_PERSON_KEYPOINTS) lastActivity = std::max(lastActivity, time);
+}
+
+bool idleResting() {
+    return enabled && resting;
+}
+
+void idlePrintStats() {
+    if (!enabled || framesObserved == 0) return;
+    long inferences = inferencesRun + inferencesSkipped;
+    std::cout << "Idle detector: " << framesObserved << " frames observed (" << framesPolled
+              << " while resting), pose network ran on " << inferencesRun << " of " << inferences
+              << " frames" << std::endl;
+}
@@ -0,0 +1,36 @@
+#ifndef IDLE_DETECTOR_H
+#define IDLE_DETECTOR_H
+
+#include "common.h"
+
+// Scene-change and presence tracking that lets an unattended kiosk rest.
+// Every captured frame is reduced to a tiny grayscale thumbnail and compared
+// with the previous one (is anything moving?) and with the frame the pose
+// network last ran on (has the scene changed since?). The network is skipped
+// while the scene is unchanged and the last pose is reused. When nothing has
+// moved and no one has been seen for IDLE_AFTER_SECONDS, the camera is only
+// read every IDLE_POLL_SECONDS; the first polled frame that differs brings
+// capture and inference back to full rate.
+const int IDLE_PIXEL_DELTA = 12;               // gray levels a thumbnail pixel must change by
+const float IDLE_CHANGED_FRACTION = 0.004f;    // share of thumbnail pixels that must change
+const int IDLE_PERSON_KEYPOINTS = 3;           // confident keypoints that count as someone present
+const double IDLE_AFTER_SECONDS = 5.0;
+const double IDLE_POLL_SECONDS = 0.25;
+
+void idleSetEnabled(bool enabled);
+bool idleEnabled();
+
+// Capture side: whether to read the camera now, and the frame that was read.
+bool idleShouldCapture(double time);
+void idleObserveFrame(const cv::Mat& frame, double time);
+
+// Inference side: whether the scene changed since the network last ran (if
+// so, this frame becomes the new reference), and whether the resulting or
+// reused pose shows someone.
+bool idleShouldInfer(const cv::Mat& frame);
+void idleReportPose(const Keypoint* keypoints, double time);
+
+bool idleResting();
+void idlePrintStats();
+
+#endif
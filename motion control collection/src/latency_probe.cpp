@@ -0,0 +1,275 @@
+#include "latency_probe.h"
+#include "capture_source.h"
+#include <chrono>
+#include <cstring>
+
+typedef std::chrono::steady_clock ProbeClock;
+
+struct LatencySample {
+    double captureMs;
+    double poseMs;
+    double displayMs;
+    double totalMs;
+};
+
+static const int SYNTH_WIDTH = 640;
+static const int SYNTH_HEIGHT = 480;
+static const int SYNTH_LEAD_FRAMES = 45;
+static const int SYNTH_HOLD_FRAMES = 30;
+static const int SYNTH_SWEEP_FRAMES = 12;
+static const int SYNTH_BLOB_SIZE = 60;
+static const int ONSET_QUIET_FRAMES = 8;
+static const float POSE_RESPONSE_THRESHOLD = 0.03f;
+static const int NUM_PROBE_FIELDS = 5;
+
+static bool active = false;
+static std::string inputName;
+static int syntheticEvents = 0;
+static std::vector<long> eventFrames;
+static size_t nextEvent = 0;
+
+static bool armed = false;
+static bool poseMoved = false;
+static int presentsSincePose = 0;
+static ProbeClock::time_point dueTime;
+static ProbeClock::time_point readTime;
+static ProbeClock::time_point poseTime;
+static float baseline[NUM_PROBE_FIELDS];
+static float lastPose[NUM_PROBE_FIELDS] = {0.5f, 0.3f, 0.5f, 0.7f, 0.5f};
+
+static std::vector<LatencySample> samples;
+static int missed = 0;
+
+static double elapsedMs(ProbeClock::time_point from, ProbeClock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// Two bright squares, one per half of the frame so both-hands games see them,
+// rest at the top or bottom and then sweep to the other end. The first sweep
+// frame of each cycle is the motion onset.
+static bool syntheticFrame(long index, cv::Mat& frame) {
+    long period = SYNTH_HOLD_FRAMES + SYNTH_SWEEP_FRAMES;
+    long total = SYNTH_LEAD_FRAMES + period * syntheticEvents + SYNTH_HOLD_FRAMES;
+    if (index >= total) return false;
+
+    float pos = 0;
+    long t = index - SYNTH_LEAD_FRAMES;
+    if (t >= 0) {
+        long cycle = t / period;
+        long phase = t % period;
+        float from = (cycle % 2 == 0) ? 0.0f : 1.0f;
+        float to = 1.0f - from;
+        if (cycle >= syntheticEvents) {
+            pos = from;
+        } else if (phase < SYNTH_HOLD_FRAMES) {
+            pos = from;
+        } else {
+            pos = from + (to - from) * (phase - SYNTH_HOLD_FRAMES + 1) / SYNTH_SWEEP_FRAMES;
+        }
+    }
+
+    frame.create(SYNTH_HEIGHT, SYNTH_WIDTH, CV_8UC3);
+    frame.setTo(cv::Scalar(30, 30, 30));
+    int y = (int)((0.2f + 0.6f * pos) * SYNTH_HEIGHT) - SYNTH_BLOB_SIZE / 2;
+    for (int i = 0; i < 2; i++) {
+        int x = SYNTH_WIDTH / 4 + i * SYNTH_WIDTH / 2 - SYNTH_BLOB_SIZE / 2;
+        cv::rectangle(frame, cv::Rect(x, y, SYNTH_BLOB_SIZE, SYNTH_BLOB_SIZE), cv::Scalar(230, 230, 230), -1);
+    }
+    return true;
+}
+
+// An onset is a frame whose motion energy jumps above the clip's 90th
+// percentile after at least ONSET_QUIET_FRAMES of near-median stillness.
+static bool scanMotionOnsets(const std::string& path, int maxEvents) {
+    cv::VideoCapture scan(path);
+    if (!scan.isOpened()) {
+        std::cerr << "Could not open latency test video: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<double> energy;
+    cv::Mat frame, gray, prevGray, diff;
+    while (scan.read(frame)) {
+        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+        cv::resize(gray, gray, cv::Size(160, 120));
+        if (prevGray.empty()) {
+            energy.push_back(0);
+        } else {
+            cv::absdiff(gray, prevGray, diff);
+            energy.push_back(cv::mean(diff)[0]);
+        }
+        std::swap(gray, prevGray);
+    }
+    if (energy.size() < 2) {
+        std::cerr << "Latency test video is too short: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<double> sorted = energy;
+    std::sort(sorted.begin(), sorted.end());
+    double quiet = sorted[sorted.size() / 2] * 1.5 + 0.5;
+    double high = std::max(sorted[sorted.size() * 9 / 10], quiet * 3);
+
+    int quietRun = 0;
+    for (size_t i = 1; i < energy.size() && (int)eventFrames.size() < maxEvents; i++) {
+        if (energy[i] >= high && quietRun >= ONSET_QUIET_FRAMES) {
+            eventFrames.push_back((long)i);
+            quietRun = 0;
+        } else if (energy[i] < quiet) {
+            quietRun++;
+        } else {
+            quietRun = 0;
+        }
+    }
+    if (eventFrames.empty()) {
+        std::cerr << "No motion onsets found in " << path
+                  << " (the clip needs still pauses between movements)" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool latencyProbeOpen(CaptureSource& cap, const std::string& input, int events, double fps) {
+    eventFrames.clear();
+    samples.clear();
+    nextEvent = 0;
+    missed = 0;
+    armed = false;
+    inputName = input;
+
+    if (input == "synthetic") {
+        syntheticEvents = events;
+        long period = SYNTH_HOLD_FRAMES + SYNTH_SWEEP_FRAMES;
+        for (int i = 0; i < events; i++) {
+            eventFrames.push_back(SYNTH_LEAD_FRAMES + i * period + SYNTH_HOLD_FRAMES);
+        }
+        if (!cap.openGenerator("synthetic", syntheticFrame, fps, true)) return false;
+    } else {
+        if (!scanMotionOnsets(input, events)) return false;
+        if (!cap.openInput(input, true, false, fps)) return false;
+    }
+
+    std::cout << "Latency test: " << eventFrames.size() << " motion events" << std::endl;
+    active = true;
+    return true;
+}
+
+bool latencyProbeActive() {
+    return active;
+}
+
+void latencyProbeFrameDelivered(const CaptureSource& cap, long index) {
+    ProbeClock::time_point now = ProbeClock::now();
+    while (nextEvent < eventFrames.size() && index >= eventFrames[nextEvent]) {
+        if (armed) missed++;
+        armed = true;
+        poseMoved = false;
+        // An onset frame that was read is timed from its capture; one that
+        // was skipped from when it was due.
+        dueTime = index == eventFrames[nextEvent] ? cap.frameCaptureTime()
+                                                  : cap.frameDueTime(eventFrames[nextEvent]);
+        readTime = now;
+        std::memcpy(baseline, lastPose, sizeof(baseline));
+        nextEvent++;
+    }
+}
+
+void latencyProbePose(const PoseDetector& pose) {
+    if (!active) return;
+    lastPose[0] = pose.armCenterY;
+    lastPose[1] = pose.leftHandX;
+    lastPose[2] = pose.leftHandY;
+    lastPose[3] = pose.rightHandX;
+    lastPose[4] = pose.rightHandY;
+    if (!armed || poseMoved) return;
+
+    for (int i = 0; i < NUM_PROBE_FIELDS; i++) {
+        if (std::abs(lastPose[i] - baseline[i]) > POSE_RESPONSE_THRESHOLD) {
+            poseMoved = true;
+            presentsSincePose = 0;
+            poseTime = ProbeClock::now();
+            break;
+        }
+    }
+}
+
+void latencyProbePresented(int framesBehind) {
+    if (!active || !armed || !poseMoved) return;
+    if (presentsSincePose++ < framesBehind) return;
+    ProbeClock::time_point now = ProbeClock::now();
+    LatencySample sample;
+    sample.captureMs = elapsedMs(dueTime, readTime);
+    sample.poseMs = elapsedMs(readTime, poseTime);
+    sample.displayMs = elapsedMs(poseTime, now);
+    sample.totalMs = elapsedMs(dueTime, now);
+    samples.push_back(sample);
+    armed = false;
+}
+
+struct LatencySummary {
+    double mean, p50, p90, p99, max;
+};
+
+static LatencySummary summarize(std::vector<double> values) {
+    LatencySummary s = {0, 0, 0, 0, 0};
+    if (values.empty()) return s;
+    std::sort(values.begin(), values.end());
+    for (double v : values) s.mean += v;
+    s.mean /= values.size();
+    s.p50 = values[(values.size() - 1) * 50 / 100];
+    s.p90 = values[(values.size() - 1) * 90 / 100];
+    s.p99 = values[(values.size() - 1) * 99 / 100];
+    s.max = values.back();
+    return s;
+}
+
+static void writeSummaryJson(std::ostream& out, const char* name, const LatencySummary& s) {
+    out << ",\"" << name << "\":{\"mean\":" << s.mean << ",\"p50\":" << s.p50 << ",\"p90\":" << s.p90
+        << ",\"p99\":" << s.p99 << ",\"max\":" << s.max << "}";
+}
+
+void latencyProbeReport(const std::string& game, const std::string& backend, const std::string& outPath) {
+    if (!active) return;
+    if (armed) missed++;
+    int unreached = (int)(eventFrames.size() - nextEvent);
+
+    std::vector<double> capture, pose, display, total;
+    for (const LatencySample& s : samples) {
+        capture.push_back(s.captureMs);
+        pose.push_back(s.poseMs);
+        display.push_back(s.displayMs);
+        total.push_back(s.totalMs);
+    }
+    LatencySummary totalSummary = summarize(total);
+    LatencySummary captureSummary = summarize(capture);
+    LatencySummary poseSummary = summarize(pose);
+    LatencySummary displaySummary = summarize(display);
+
+    std::cout << "Latency " << game << " / " << backend << " / " << inputName << ": "
+              << samples.size() << " measured, " << missed << " without a pose response";
+    if (unreached > 0) std::cout << ", " << unreached << " not played";
+    std::cout << std::endl;
+    std::cout << "  total    mean " << totalSummary.mean << "  p50 " << totalSummary.p50
+              << "  p90 " << totalSummary.p90 << "  p99 " << totalSummary.p99
+              << "  max " << totalSummary.max << " ms" << std::endl;
+    std::cout << "  capture  mean " << captureSummary.mean << " ms (frame due -> read)" << std::endl;
+    std::cout << "  pose     mean " << poseSummary.mean << " ms (read -> pose output moved)" << std::endl;
+    std::cout << "  display  mean " << displaySummary.mean << " ms (pose moved -> present)" << std::endl;
+
+    if (outPath.empty()) return;
+    std::ofstream out(outPath, std::ios::app);
+    if (!out) {
+        std::cerr << "Could not write latency results to " << outPath << std::endl;
+        return;
+    }
+    out << "{\"game\":\"" << game << "\",\"backend\":\"" << backend << "\",\"input\":\"";
+    writeJsonEscaped(out, inputName);
+    out << "\",\"events\":" << eventFrames.size() << ",\"measured\":" << samples.size()
+        << ",\"missed\":" << missed << ",\"not_played\":" << unreached;
+    writeSummaryJson(out, "total_ms", totalSummary);
+    writeSummaryJson(out, "capture_ms", captureSummary);
+    writeSummaryJson(out, "pose_ms", poseSummary);
+    writeSummaryJson(out, "display_ms", displaySummary);
+    out << "}\n";
+    std::cout << "Latency results appended to " << outPath << std::endl;
+}
@@ -0,0 +1,23 @@
+#ifndef LATENCY_PROBE_H
+#define LATENCY_PROBE_H
+
+#include "common.h"
+#include <string>
+
+class CaptureSource;
+
+// Motion-to-photon measurement through the real capture, pose and game path.
+// The capture source plays frames with known motion onsets: either synthetic
+// blobs that rest and then sweep, or a recorded video whose onsets are found
+// by a motion-energy pre-scan. For every onset the probe notes when the frame
+// was due, when the game read it, when the pose output first moved and when
+// the frame showing that movement was presented. framesBehind is how many
+// presents after the pose was read still show older game state.
+bool latencyProbeOpen(CaptureSource& cap, const std::string& input, int events, double fps);
+bool latencyProbeActive();
+void latencyProbeFrameDelivered(const CaptureSource& cap, long index);
+void latencyProbePose(const PoseDetector& pose);
+void latencyProbePresented(int framesBehind);
+void latencyProbeReport(const std::string& game, const std::string& backend, const std::string& outPath);
+
+#endif
@@ -1,22 +1,137 @@
 #include "common.h"
 #include "menu.h"
-#include "pickleball_game.h"
-#include "boxing_game.h"
-#include "tennis_game.h"
-#include "archery_game.h"
-#include "rhythm_dance_game.h"
+#include "game.h"
+#include "session.h"
+#include "capture_source.h"
+#include "trace.h"
+#include "latency_probe.h"
+#include "asset_pack.h"
+#include "audio_engine.h"
+#include "thread_config.h"
+#include "pose_int8.h"
+#include "idle_detector.h"
+#include "soak.h"
+#include "video_record.h"
+#include "pose_pipeline.h"
+#include <cstdio>
+#include <cstring>
 
 int main(int argc, char* argv[]) {
+    std::string recordPath, replayPath, inputPath, tracePath;
+    std::string latencyInput, latencyOut, poseBackend;
+    std::string v4l2Device, videoPath;
+    double videoFps = VIDEO_DEFAULT_FPS;
+    int v4l2Width = CAM_WIDTH, v4l2Height = CAM_HEIGHT;
+    int latencyEvents = 20;
+    int poseDepth = 1;
+    int audioBuffer = AUDIO_DEFAULT_BUFFER;
+    bool inputRealtime = true;
+    bool inputLoop = false;
+    double inputFps = 30.0;
+    int startGame = 0;
+    ThreadConfig threadConfig;
+    bool configureThreads = true;
+    bool idleThrottle = true;
+    bool soak = false;
+    SoakOptions soakOptions;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (arg == "--video" && i + 1 < argc) {
+            videoPath = argv[++i];
+        } else if (arg == "--video-fps" && i + 1 < argc) {
+            videoFps = std::max(1.0, std::atof(argv[++i]));
+        } else if (arg == "--input" && i + 1 < argc) {
+            inputPath = argv[++i];
+        } else if (arg == "--v4l2" && i + 1 < argc) {
+            v4l2Device = argv[++i];
+        } else if (arg == "--v4l2-size" && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%dx%d", &v4l2Width, &v4l2Height) != 2) {
+                std::cerr << "--v4l2-size expects WIDTHxHEIGHT" << std::endl;
+                v4l2Width = CAM_WIDTH;
+                v4l2Height = CAM_HEIGHT;
+            }
+        } else if (arg == "--pace" && i + 1 < argc) {
+            inputRealtime = std::string(argv[++i]) != "fast";
+        } else if (arg == "--loop") {
+            inputLoop = true;
+        } else if (arg == "--input-fps" && i + 1 < argc) {
+            inputFps = std::max(1.0, std::atof(argv[++i]));
+        } else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "--latency-test" && i + 1 < argc) {
+            latencyInput = argv[++i];
+        } else if (arg == "--latency-events" && i + 1 < argc) {
+            latencyEvents = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--latency-out" && i + 1 < argc) {
+            latencyOut = argv[++i];
+        } else if (arg == "--pose-backend" && i + 1 < argc) {
+            poseBackend = argv[++i];
+        } else if (arg == "--pose-pipeline" && i + 1 < argc) {
+            poseDepth = std::max(1, std::min(POSE_PIPELINE_MAX_DEPTH, std::atoi(argv[++i])));
+        } else if (arg == "--audio-buffer" && i + 1 < argc) {
+            audioBuffer = std::max(64, std::atoi(argv[++i]));
+        } else if (arg == "--low-latency-audio") {
+            audioBuffer = AUDIO_LOW_LATENCY_BUFFER;
+        } else if (arg == "--audio-offset" && i + 1 < argc) {
+            audioSetCalibrationOffset(std::atof(argv[++i]));
+        } else if (arg == "--inference-threads" && i + 1 < argc) {
+            threadConfig.inferenceThreads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--main-cpus" && i + 1 < argc) {
+            if (!threadConfigParseCpus(argv[++i], threadConfig.mainCpus)) {
+                std::cerr << "--main-cpus expects a list like 0-2 or 0,2" << std::endl;
+                threadConfig.mainCpus.clear();
+            }
+        } else if (arg == "--audio-cpu" && i + 1 < argc) {
+            std::string cpu = argv[++i];
+            threadConfig.audioCpu = cpu == "none" ? AUDIO_CPU_NONE : std::max(0, std::atoi(cpu.c_str()));
+        } else if (arg == "--no-thread-config") {
+            configureThreads = false;
+        } else if (arg == "--no-idle") {
+            idleThrottle = false;
+        } else if (arg == "--soak" && i + 1 < argc) {
+            soak = true;
+            if (!soakParseDuration(argv[++i], soakOptions.wallSeconds)) {
+                std::cerr << "--soak expects a duration like 90s, 45m or 8h" << std::endl;
+                soakOptions.wallSeconds = 0;
+            }
+        } else if (arg == "--soak-game-seconds" && i + 1 < argc) {
+            soakOptions.gameSeconds = std::max(1.0, std::atof(argv[++i]));
+        } else if (arg == "--soak-out" && i + 1 < argc) {
+            soakOptions.outPath = argv[++i];
+        } else if (arg == "--no-present") {
+            soakOptions.present = false;
+        } else if (arg == "--game" && i + 1 < argc) {
+            startGame = std::max(0, std::min((int)gameRegistry().size(), std::atoi(argv[++i])));
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+        }
+    }
+
+    if (configureThreads) {
+        threadConfig = threadConfigResolve(threadConfig);
+        threadConfigApply(threadConfig);
+        std::cout << "Threads: " << threadConfigDescribe(threadConfig) << std::endl;
+    }
+
+    if (!tracePath.empty()) {
+        traceStart(tracePath);
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
         std::cerr << "SDL could not initialize: " << SDL_GetError() << std::endl;
         return 1;
     }
 
-    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
-        std::cerr << "SDL_mixer could not initialize: " << Mix_GetError() << std::endl;
-    }
+    audioOpen(audioBuffer);
 
-    Mix_Music* bgMusic = Mix_LoadMUS("audio and sound effects/background.mp3");
+    assetPackOpen("assets.pack");
+    audioAssetsLoadAsync();
+
+    Mix_Music* bgMusic = audioAssetMusic("audio and sound effects/background.mp3");
     if (bgMusic) {
         Mix_PlayMusic(bgMusic, -1);
         Mix_VolumeMusic(MIX_MAX_VOLUME / 3);
@@ -40,41 +155,108 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    cv::VideoCapture cap;
-#ifdef __APPLE__
-    cap.open(0, cv::CAP_AVFOUNDATION);
-#else
-    cap.open(0);
-#endif
-    bool useCamera = cap.isOpened();
-    if (useCamera) {
-        std::cout << "Camera detected. Warming up..." << std::endl;
-        cv::Mat warmup;
-        for (int i = 0; i < 30; i++) {
-            cap.read(warmup);
-            SDL_Delay(30);
+    if (!videoPath.empty()) {
+        videoRecordStart(videoPath, renderer, videoFps);
+    }
+
+    if (soak) {
+        soakOptions.scripted = replayPath.empty();
+        soakStart(soakOptions);
+    }
+
+    CaptureSource cap;
+    bool useCamera = false;
+    if (!replayPath.empty()) {
+        if (!sessionStartReplay(replayPath)) {
+            return 1;
+        }
+        useCamera = sessionRecordedCamera();
+    } else if (soak) {
+        soakOpenScript(cap);
+        useCamera = true;
+    } else if (!latencyInput.empty()) {
+        if (!latencyProbeOpen(cap, latencyInput, latencyEvents, inputFps)) {
+            return 1;
         }
-        std::cout << "Camera ready!" << std::endl;
+        if (startGame == 0) startGame = PICKLEBALL;
+        // Pickleball only follows the player once a rally is started.
+        SDL_Event start;
+        std::memset(&start, 0, sizeof(start));
+        start.type = SDL_KEYDOWN;
+        start.key.keysym.sym = SDLK_SPACE;
+        SDL_PushEvent(&start);
+        useCamera = true;
+    } else if (!inputPath.empty()) {
+        if (!cap.openInput(inputPath, inputRealtime, inputLoop, inputFps)) {
+            return 1;
+        }
+        useCamera = true;
     } else {
-        std::cout << "Camera not available. Using keyboard/mouse controls." << std::endl;
+        if (v4l2Device.empty() || !cap.openV4l2(v4l2Device, v4l2Width, v4l2Height)) {
+            if (!v4l2Device.empty()) std::cout << "Falling back to the default camera backend." << std::endl;
+            cap.openCamera();
+        }
+        useCamera = cap.isOpened();
+        if (useCamera) {
+            std::cout << "Camera detected. Warming up..." << std::endl;
+            cv::Mat warmup;
+            for (int i = 0; i < 30; i++) {
+                cap.read(warmup);
+                SDL_Delay(30);
+            }
+            std::cout << "Camera ready!" << std::endl;
+        } else {
+            std::cout << "Camera not available. Using keyboard/mouse controls." << std::endl;
+        }
     }
 
+    // The latency test and soak runs measure every frame the pipeline would
+    // process, so they always run at full rate.
+    idleSetEnabled(idleThrottle && !latencyProbeActive() && !soakActive());
+
     PoseDetector poseDetector;
-    if (useCamera) {
+    bool poseInt8 = false;
+    if (useCamera && !sessionReplaying() && !soakScripted() && poseBackend != "motion") {
         poseDetector.init();
+        if (poseBackend == "int8" && poseDetector.initialized) poseInt8 = poseUseInt8(poseDetector.net);
+    }
+    // A replay feeds the recorded pose to the gesture tracker once per frame
+    // at frame time, so a recording keeps to one network to stay exact.
+    if (poseDepth > 1 && poseDetector.initialized) {
+        if (!recordPath.empty()) {
+            std::cout << "Recording: the pose pipeline is off so the replay stays exact." << std::endl;
+        } else {
+            posePipelineStart(poseDetector.net, poseDepth, poseInt8);
+        }
     }
 
-    GameState state = MENU;
-    int selectedGame = 0;
+    if (!recordPath.empty() && !sessionReplaying()) {
+        sessionStartRecording(recordPath, useCamera);
+    }
+
+    GameState state = (GameState)startGame;
+    int selectedGame = startGame > 0 ? startGame - 1 : 0;
     bool running = true;
     bool showingInfo = false;
     cv::Mat currentFrame;
 
     while (running) {
         SDL_Event event;
-        
+
+        // Scripted soak runs skip the menu and visit every game in turn.
+        if (state == MENU && soakScripted()) {
+            if (soakFinished()) break;
+            state = (GameState)(selectedGame + 1);
+            if (startGame == 0) selectedGame = (selectedGame + 1) % (int)gameRegistry().size();
+        }
+
         if (state == MENU) {
-            while (SDL_PollEvent(&event)) {
+            TRACE_SCOPE("frame");
+            TRACE_STAGE("events");
+            // Menu frames are part of the session too, so a replay walks the
+            // menu into the same games.
+            sessionBeginFrame();
+            while (sessionPollEvent(&event)) {
                 if (event.type == SDL_QUIT) running = false;
                 else if (event.type == SDL_KEYDOWN) {
                     if (showingInfo) {
@@ -98,40 +280,30 @@ int main(int argc, char* argv[]) {
                 }
             }
 
-            if (useCamera && cap.read(currentFrame)) {
-                cv::flip(currentFrame, currentFrame, 1);
-            }
+            TRACE_NEXT_STAGE("input");
+            if (useCamera) sessionCaptureFrame(cap, currentFrame);
 
+            TRACE_NEXT_STAGE("draw");
             drawMenu(renderer, selectedGame);
             if (showingInfo) {
                 drawInfoPopup(renderer, selectedGame);
             }
             drawCameraFeed(renderer, currentFrame, useCamera);
+            TRACE_NEXT_STAGE("present");
+            videoRecordFrame(renderer);
             SDL_RenderPresent(renderer);
+            TRACE_NEXT_STAGE("sleep");
             SDL_Delay(16);
         } else {
             bool returnToMenu = false;
-            
-            switch (state) {
-                case PICKLEBALL:
-                    runPickleball(renderer, poseDetector, cap, useCamera, currentFrame, returnToMenu);
-                    break;
-                case BOXING:
-                    runBoxing(renderer, poseDetector, cap, useCamera, currentFrame, returnToMenu, bgMusic);
-                    break;
-                case TENNIS:
-                    runTennis(renderer, poseDetector, cap, useCamera, currentFrame, returnToMenu);
-                    break;
-                case ARCHERY:
-                    runArchery(renderer, poseDetector, cap, useCamera, currentFrame, returnToMenu, bgMusic);
-                    break;
-                case RHYTHM_DANCE:
-                    runRhythmDance(renderer, poseDetector, cap, useCamera, currentFrame, returnToMenu, bgMusic);
-                    break;
-                default:
-                    break;
+            const GameRegistration* registration = gameFind(state);
+            if (registration) {
+                std::unique_ptr<Game> game = registration->create(bgMusic);
+                if (soakActive()) soakBeginGame(registration->name);
+                returnToMenu = gameRun(*game, renderer, poseDetector, cap, useCamera, currentFrame);
+                if (soakActive()) soakEndGame();
             }
-            
+
             if (returnToMenu) {
                 state = MENU;
             } else {
@@ -140,8 +312,23 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    if (bgMusic) Mix_FreeMusic(bgMusic);
-    Mix_CloseAudio();
+    sessionStop();
+    videoRecordStop();
+    std::string backendName = poseInt8 ? "openpose-int8" : poseDetector.initialized ? "openpose" : "motion";
+    if (posePipelineActive()) backendName += "-pipeline" + std::to_string(posePipelineDepth());
+    posePipelineStop();
+    traceStop();
+    if (latencyProbeActive()) {
+        const GameRegistration* registration = gameFind((GameState)startGame);
+        latencyProbeReport(registration ? registration->name : "menu", backendName, latencyOut);
+    }
+    cap.printStats();
+    idlePrintStats();
+    soakPrintSummary();
+    audioAssetsFree();
+    assetPackClose();
+    audioPrintStats();
+    audioClose();
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
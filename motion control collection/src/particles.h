@@ -0,0 +1,51 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include "common.h"
+
+// Short-lived effect particles for hits, impacts and combos. Storage is a
+// fixed pool of structure-of-arrays columns allocated up front; the update
+// loop runs over flat float arrays the compiler can vectorize and dead
+// particles are swap-removed. The whole pool is drawn with one
+// SDL_RenderGeometry call, an additive diamond per particle that shrinks
+// and fades as it ages.
+struct ParticleBurst {
+    int count;
+    float minSpeed, maxSpeed;   // pixels per second
+    float minLife, maxLife;     // seconds
+    float size;                 // half width at birth, pixels
+    float gravity;              // pixels per second squared
+    Color from, to;             // each particle gets a colour between these
+};
+
+extern const ParticleBurst PARTICLES_HIT;
+extern const ParticleBurst PARTICLES_IMPACT;
+extern const ParticleBurst PARTICLES_COMBO;
+
+class ParticleSystem {
+public:
+    static const int MAX_PARTICLES = 4096;
+
+    int count = 0;
+    std::vector<float> x, y, vx, vy, gravity, life, fadeRate, size;   // life runs from 1 to 0
+    std::vector<SDL_Color> color;
+
+    ParticleSystem();
+    ParticleSystem(const ParticleSystem& other) = default;
+
+    // Game states are copied on every publish; only live particles are.
+    ParticleSystem& operator=(const ParticleSystem& other);
+
+    void clear();
+    // Bursts that do not fit in the pool are cut short.
+    void burst(float cx, float cy, const ParticleBurst& style, float scale = 1.0f);
+    void update(float dt);
+    void draw(SDL_Renderer* renderer) const;
+
+private:
+    Uint32 rng = 0x9E3779B9u;
+
+    float random(float lo, float hi);
+};
+
+#endif
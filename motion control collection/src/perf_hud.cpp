@@ -0,0 +1,179 @@
+#include "perf_hud.h"
+#include "trace.h"
+#include "audio_engine.h"
+#include <chrono>
+#include <cstdio>
+
+typedef std::chrono::steady_clock HudClock;
+
+struct RateCounter {
+    int count = 0;
+    double rate = 0;
+    HudClock::time_point windowStart = HudClock::now();
+
+    void update(HudClock::time_point now) {
+        double elapsed = std::chrono::duration<double>(now - windowStart).count();
+        if (elapsed >= 0.5) {
+            rate = count / elapsed;
+            count = 0;
+            windowStart = now;
+        }
+    }
+};
+
+struct HudStage {
+    const char* name;
+    const char* label;
+};
+
+static const HudStage HUD_STAGES[] = {
+    {"capture", "CAPTURE"},
+    {"prepare", "PREPARE"},
+    {"preprocess", "PREPROCESS"},
+    {"inference", "INFERENCE"},
+    {"postprocess", "POSTPROCESS"},
+    {"motion_fallback", "MOTION"},
+    {"simulation", "SIMULATION"},
+    {"draw", "DRAW"},
+    {"present", "PRESENT"},
+};
+
+static const int SPARKLINE_SAMPLES = 150;
+static const float SPARKLINE_MAX_MS = 50.0f;
+static const double LATENCY_SMOOTHING = 0.1;
+
+static bool visible = false;
+static RateCounter renderRate;
+static RateCounter cameraRate;
+static RateCounter poseRate;
+static const char* poseBackend = "NONE";
+
+static bool hasLastDraw = false;
+static HudClock::time_point lastDrawTime;
+static float frameTimes[SPARKLINE_SAMPLES] = {};
+static int frameTimeHead = 0;
+
+static bool newCameraFrame = false;
+static HudClock::time_point lastCameraTime;
+static double latencyMs = -1;
+
+void perfHudHandleEvent(const SDL_Event& event) {
+    if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3 && !event.key.repeat) {
+        visible = !visible;
+        traceSetStageStats(visible);
+    }
+}
+
+bool perfHudVisible() {
+    return visible;
+}
+
+void perfHudCameraFrame() {
+    cameraRate.count++;
+    lastCameraTime = HudClock::now();
+    newCameraFrame = true;
+}
+
+void perfHudPoseUpdate(const char* backend) {
+    poseRate.count++;
+    poseBackend = backend;
+}
+
+// Capture-to-display estimate: one camera frame interval for exposure and
+// driver buffering, the time since the frame left cap.read, and the last
+// measured present.
+static void sampleLatency(HudClock::time_point now) {
+    if (!newCameraFrame) return;
+    newCameraFrame = false;
+
+    double sample = std::chrono::duration<double, std::milli>(now - lastCameraTime).count();
+    if (cameraRate.rate > 0) sample += 1000.0 / cameraRate.rate;
+    double presentMs = traceStageMs("present");
+    if (presentMs > 0) sample += presentMs;
+
+    latencyMs = latencyMs < 0 ? sample : latencyMs + (sample - latencyMs) * LATENCY_SMOOTHING;
+}
+
+static void drawHudLine(SDL_Renderer* renderer, int x, int y, const char* label, double value, const char* unit) {
+    char text[48];
+    if (value < 0) {
+        std::snprintf(text, sizeof(text), "%s --", label);
+    } else {
+        std::snprintf(text, sizeof(text), "%s %.1f%s", label, value, unit);
+    }
+    drawText(renderer, text, x, y, 8);
+}
+
+static void drawSparkline(SDL_Renderer* renderer, int x, int y, int width, int height) {
+    SDL_SetRenderDrawColor(renderer, 25, 25, 25, 255);
+    SDL_Rect bg = {x, y, width, height};
+    SDL_RenderFillRect(renderer, &bg);
+
+    int step = std::max(1, width / SPARKLINE_SAMPLES);
+    for (int i = 0; i < SPARKLINE_SAMPLES; i++) {
+        float ms = frameTimes[(frameTimeHead + i) % SPARKLINE_SAMPLES];
+        if (ms <= 0) continue;
+        int barHeight = (int)(std::min(ms, SPARKLINE_MAX_MS) / SPARKLINE_MAX_MS * height);
+        if (ms < 20.0f) {
+            SDL_SetRenderDrawColor(renderer, GREEN.r, GREEN.g, GREEN.b, 255);
+        } else if (ms < 34.0f) {
+            SDL_SetRenderDrawColor(renderer, ORANGE.r, ORANGE.g, ORANGE.b, 255);
+        } else {
+            SDL_SetRenderDrawColor(renderer, RED.r, RED.g, RED.b, 255);
+        }
+        SDL_Rect bar = {x + i * step, y + height - barHeight, step, barHeight};
+        SDL_RenderFillRect(renderer, &bar);
+    }
+
+    int targetY = y + height - (int)(1000.0f / 60.0f / SPARKLINE_MAX_MS * height);
+    SDL_SetRenderDrawColor(renderer, YELLOW.r, YELLOW.g, YELLOW.b, 255);
+    SDL_RenderDrawLine(renderer, x, targetY, x + width - 1, targetY);
+}
+
+void drawPerfHud(SDL_Renderer* renderer, int x, int y, int width, int height) {
+    HudClock::time_point now = HudClock::now();
+    if (hasLastDraw) {
+        frameTimes[frameTimeHead] = std::chrono::duration<float, std::milli>(now - lastDrawTime).count();
+        frameTimeHead = (frameTimeHead + 1) % SPARKLINE_SAMPLES;
+    }
+    hasLastDraw = true;
+    lastDrawTime = now;
+
+    renderRate.count++;
+    renderRate.update(now);
+    cameraRate.update(now);
+    poseRate.update(now);
+    sampleLatency(now);
+
+    if (!visible) return;
+
+    int left = x + 10;
+    int lineY = y + 12;
+    const int lineHeight = 14;
+
+    SDL_SetRenderDrawColor(renderer, WHITE.r, WHITE.g, WHITE.b, WHITE.a);
+    drawHudLine(renderer, left, lineY, "RENDER FPS", renderRate.rate, "");
+    lineY += lineHeight;
+    drawHudLine(renderer, left, lineY, "CAMERA FPS", cameraRate.rate, "");
+    lineY += lineHeight;
+    drawHudLine(renderer, left, lineY, "POSE FPS", poseRate.rate, "");
+    lineY += lineHeight;
+    char backendText[48];
+    std::snprintf(backendText, sizeof(backendText), "BACKEND %s", poseBackend);
+    drawText(renderer, backendText, left, lineY, 8);
+    lineY += lineHeight;
+    drawHudLine(renderer, left, lineY, "LATENCY", latencyMs, " MS");
+    lineY += lineHeight;
+    drawHudLine(renderer, left, lineY, "AUDIO LATENCY", audioOutputLatencyMs(), " MS");
+    lineY += lineHeight + lineHeight / 2;
+
+    SDL_SetRenderDrawColor(renderer, 180, 180, 180, 255);
+    for (const HudStage& stage : HUD_STAGES) {
+        double ms = traceStageMs(stage.name);
+        if (ms < 0) continue;
+        drawHudLine(renderer, left, lineY, stage.label, ms, " MS");
+        lineY += lineHeight;
+    }
+
+    drawSparkline(renderer, left, y + height - 70, width - 20, 60);
+}
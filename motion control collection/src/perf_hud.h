@@ -0,0 +1,16 @@
+#ifndef PERF_HUD_H
+#define PERF_HUD_H
+
+#include "common.h"
+
+// Performance overlay for the info panel under the camera preview, toggled
+// with F3. Frame timing is sampled on every drawCameraFeed call whether or
+// not the HUD is visible; per-stage times come from the trace markers and
+// are only collected while it is shown.
+void perfHudHandleEvent(const SDL_Event& event);
+bool perfHudVisible();
+void perfHudCameraFrame();
+void perfHudPoseUpdate(const char* backend);
+void drawPerfHud(SDL_Renderer* renderer, int x, int y, int width, int height);
+
+#endif
@@ -1,4 +1,6 @@
 #include "pickleball_game.h"
+#include "session.h"
+#include "audio_engine.h"
 
 class Paddle {
 public:
@@ -22,7 +24,7 @@ public:
         y = std::max(60.0f, std::min((float)(GAME_HEIGHT - 60 - height), y));
     }
 
-    void draw(SDL_Renderer* renderer) {
+    void draw(SDL_Renderer* renderer) const {
         SDL_Rect rect = {(int)x, (int)y, width, height};
         SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
         SDL_RenderFillRect(renderer, &rect);
@@ -45,8 +47,7 @@ public:
         x = GAME_WIDTH / 2.0f;
         y = GAME_HEIGHT / 2.0f;
         
-        std::random_device rd;
-        std::mt19937 gen(rd());
+        std::mt19937 gen(sessionSeed());
         std::uniform_real_distribution<> angleDist(-0.5, 0.5);
         std::uniform_int_distribution<> dirDist(0, 1);
         
@@ -68,7 +69,7 @@ public:
         }
     }
 
-    bool checkPaddleCollision(Paddle& paddle) {
+    bool checkPaddleCollision(const Paddle& paddle) {
         if (paddle.x < x && x < paddle.x + paddle.width + radius &&
             paddle.y - radius < y && y < paddle.y + paddle.height + radius) {
             float relativeY = (y - paddle.y) / paddle.height - 0.5f;
@@ -91,7 +92,7 @@ public:
         return false;
     }
 
-    void draw(SDL_Renderer* renderer) {
+    void draw(SDL_Renderer* renderer) const {
         for (size_t i = 0; i < trail.size(); i++) {
             int trailRadius = std::max(2, (int)(radius * i / trail.size()));
             SDL_SetRenderDrawColor(renderer, 255, 255, 100, 255);
@@ -104,19 +105,14 @@ public:
 
 class AIOpponent {
 public:
-    Paddle& paddle;
-    Ball& ball;
-    float targetY;
+    float targetY = GAME_HEIGHT / 2.0f;
     float difficulty = 0.7f;
 
-    AIOpponent(Paddle& p, Ball& b) : paddle(p), ball(b), targetY(GAME_HEIGHT / 2.0f) {}
-
-    void update() {
+    void update(Paddle& paddle, const Ball& ball) {
         if (ball.speedX > 0) {
-            float predictedY = predictBallY();
+            float predictedY = predictBallY(paddle, ball);
             targetY = predictedY - paddle.height / 2.0f;
-            std::random_device rd;
-            std::mt19937 gen(rd());
+            std::mt19937 gen(sessionSeed());
             std::uniform_real_distribution<> noiseDist(-30, 30);
             targetY += noiseDist(gen) * (1 - difficulty);
         } else {
@@ -125,7 +121,7 @@ public:
         paddle.move(targetY);
     }
 
-    float predictBallY() {
+    float predictBallY(const Paddle& paddle, const Ball& ball) const {
         float px = ball.x, py = ball.y;
         float vx = ball.speedX, vy = ball.speedY;
         while (px < paddle.x) {
@@ -175,63 +171,67 @@ static void drawScore(SDL_Renderer* renderer, int playerScore, int aiScore) {
     drawNumber(renderer, aiScore, GAME_WIDTH - 200, 20, 30);
 }
 
-void runPickleball(SDL_Renderer* renderer, PoseDetector& poseDetector, cv::VideoCapture& cap, 
-                   bool useCamera, cv::Mat& currentFrame, bool& returnToMenu) {
-    Paddle player(70, GAME_HEIGHT / 2.0f - 40, true);
-    Paddle opponent(GAME_WIDTH - 85, GAME_HEIGHT / 2.0f - 40, false);
+struct PickleballState {
+    Paddle player{70, GAME_HEIGHT / 2.0f - 40, true};
+    Paddle opponent{GAME_WIDTH - 85, GAME_HEIGHT / 2.0f - 40, false};
     Ball ball;
-    AIOpponent ai(opponent, ball);
-    
+    AIOpponent ai;
     int playerScore = 0, aiScore = 0;
     bool gameStarted = false;
-    bool running = true;
-
-    while (running && !returnToMenu) {
-        SDL_Event event;
-        while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_QUIT) { running = false; returnToMenu = false; }
-            else if (event.type == SDL_KEYDOWN) {
-                switch (event.key.keysym.sym) {
-                    case SDLK_ESCAPE: returnToMenu = true; break;
-                    case SDLK_q: returnToMenu = true; break;
-                    case SDLK_SPACE: if (!gameStarted) { gameStarted = true; ball.reset(); } break;
-                    case SDLK_r: ball.reset(); playerScore = 0; aiScore = 0; break;
-                }
+};
+
+class PickleballGame : public Game {
+public:
+    PickleballGame() : state(PickleballState()) {}
+
+    PoseMode poseMode() const override { return POSE_ARM; }
+
+    void update(float, const GameInput& input) override {
+        PickleballState& s = state.back();
+        for (const SDL_Event& event : input.events) {
+            if (event.type != SDL_KEYDOWN) continue;
+            switch (event.key.keysym.sym) {
+                case SDLK_SPACE: if (!s.gameStarted) { s.gameStarted = true; s.ball.reset(); } break;
+                case SDLK_r: s.ball.reset(); s.playerScore = 0; s.aiScore = 0; break;
             }
         }
 
-        const Uint8* keys = SDL_GetKeyboardState(NULL);
-        if (!useCamera) {
-            if (keys[SDL_SCANCODE_W] || keys[SDL_SCANCODE_UP]) player.move(player.y - 10);
-            if (keys[SDL_SCANCODE_S] || keys[SDL_SCANCODE_DOWN]) player.move(player.y + 10);
+        if (!input.useCamera) {
+            if (input.keys[SDL_SCANCODE_W] || input.keys[SDL_SCANCODE_UP]) s.player.move(s.player.y - 10);
+            if (input.keys[SDL_SCANCODE_S] || input.keys[SDL_SCANCODE_DOWN]) s.player.move(s.player.y + 10);
         }
-
-        if (useCamera && cap.read(currentFrame)) {
-            cv::flip(currentFrame, currentFrame, 1);
-            float armY = poseDetector.detectArmPosition(currentFrame);
-            if (gameStarted) {
-                float paddleY = armY * (GAME_HEIGHT - 200) + 60;
-                player.move(paddleY);
-            }
+        if (input.pose.detected && s.gameStarted) {
+            float paddleY = input.pose.armY * (GAME_HEIGHT - 200) + 60;
+            s.player.move(paddleY);
         }
 
-        if (gameStarted) {
-            ball.update();
-            ai.update();
-            ball.checkPaddleCollision(player);
-            ball.checkPaddleCollision(opponent);
-            
-            if (ball.x < 0) { aiScore++; ball.reset(); }
-            if (ball.x > GAME_WIDTH) { playerScore++; ball.reset(); }
+        if (s.gameStarted) {
+            s.ball.update();
+            s.ai.update(s.opponent, s.ball);
+            bool playerHit = s.ball.checkPaddleCollision(s.player);
+            bool opponentHit = s.ball.checkPaddleCollision(s.opponent);
+            if (playerHit || opponentHit) sfxPlay(SFX_RETURN);
+
+            if (s.ball.x < 0) { s.aiScore++; s.ball.reset(); }
+            if (s.ball.x > GAME_WIDTH) { s.playerScore++; s.ball.reset(); }
         }
+    }
 
+    void render(SDL_Renderer* renderer) override {
+        const PickleballState& s = state.front();
         drawPickleballCourt(renderer);
-        drawScore(renderer, playerScore, aiScore);
-        ball.draw(renderer);
-        player.draw(renderer);
-        opponent.draw(renderer);
-        drawCameraFeed(renderer, currentFrame, useCamera);
-        SDL_RenderPresent(renderer);
-        SDL_Delay(16);
+        drawScore(renderer, s.playerScore, s.aiScore);
+        s.ball.draw(renderer);
+        s.player.draw(renderer);
+        s.opponent.draw(renderer);
     }
+
+    void publish() override { state.publish(); }
+
+private:
+    DoubleBuffer<PickleballState> state;
+};
+
+std::unique_ptr<Game> createPickleball(Mix_Music*) {
+    return std::make_unique<PickleballGame>();
 }
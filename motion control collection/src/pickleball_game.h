@@ -1,9 +1,8 @@
 #ifndef PICKLEBALL_GAME_H
 #define PICKLEBALL_GAME_H
 
-#include "common.h"
+#include "game.h"
 
-void runPickleball(SDL_Renderer* renderer, PoseDetector& poseDetector, cv::VideoCapture& cap, 
-                   bool useCamera, cv::Mat& currentFrame, bool& returnToMenu);
+std::unique_ptr<Game> createPickleball(Mix_Music* menuMusic);
 
 #endif
@@ -0,0 +1,186 @@
+#include "pose_int8.h"
+#include "capture_source.h"
+#include "frame_prep.h"
+#include <cstdio>
+#include <sys/stat.h>
+
+static const int WRIST_PARTS[2] = {POSE_RIGHT_WRIST, POSE_LEFT_WRIST};
+
+void poseWrists(cv::Mat& output, float wrists[6]) {
+    int H = output.size[2];
+    int W = output.size[3];
+    for (int i = 0; i < 2; i++) {
+        cv::Point peak;
+        double conf;
+        findHeatmapPeak(output, WRIST_PARTS[i], peak, conf);
+        wrists[i * 3] = (float)peak.x / W;
+        wrists[i * 3 + 1] = (float)peak.y / H;
+        wrists[i * 3 + 2] = (float)conf;
+    }
+}
+
+static void forwardWrists(cv::dnn::Net& net, const cv::Mat& frame, float wrists[6]) {
+    net.setInput(framePoseBlob(frame));
+    cv::Mat output = net.forward();
+    poseWrists(output, wrists);
+}
+
+bool poseCalibrationCollect(const std::string& input, int maxFrames, cv::dnn::Net& net,
+                            PoseCalibration& calibration) {
+    CaptureSource cap;
+    if (!cap.openInput(input, false, false, 30.0)) return false;
+
+    // Keeps every stride-th frame at the pose input size, doubling the
+    // stride whenever twice the needed frames are held, so a long recording
+    // is sampled evenly without keeping all of it in memory.
+    std::vector<cv::Mat> kept;
+    long stride = 1;
+    cv::Mat frame;
+    for (long index = 0; cap.read(frame); index++) {
+        if (frame.empty() || index % stride != 0) continue;
+        cv::Mat small;
+        cv::resize(frame, small, framePoseInputSize(frame.size()), 0, 0, cv::INTER_LINEAR);
+        kept.push_back(small);
+        if ((int)kept.size() >= 2 * maxFrames) {
+            for (size_t i = 0; i < kept.size() / 2; i++) kept[i] = kept[i * 2];
+            kept.resize(kept.size() / 2);
+            stride *= 2;
+        }
+    }
+    if (kept.size() < (size_t)INT8_VALIDATION_EVERY) {
+        std::cerr << "Not enough frames in " << input << std::endl;
+        return false;
+    }
+
+    calibration = PoseCalibration();
+    int count = std::min((int)kept.size(), maxFrames);
+    for (int i = 0; i < count; i++) {
+        const cv::Mat& picked = kept[(size_t)i * kept.size() / count];
+        if (i % INT8_VALIDATION_EVERY == INT8_VALIDATION_EVERY - 1) {
+            calibration.validation.push_back(picked);
+        } else {
+            calibration.calibration.push_back(picked);
+        }
+    }
+
+    calibration.reference.create((int)calibration.validation.size(), 6, CV_32F);
+    for (size_t i = 0; i < calibration.validation.size(); i++) {
+        forwardWrists(net, calibration.validation[i], calibration.reference.ptr<float>((int)i));
+    }
+    return true;
+}
+
+static std::string framePath(const std::string& dir, const char* set, size_t index) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%s_%03zu.png", set, index);
+    return dir + name;
+}
+
+bool poseCalibrationSave(const std::string& dir, const PoseCalibration& calibration) {
+    mkdir(dir.c_str(), 0755);
+    for (size_t i = 0; i < calibration.calibration.size(); i++) {
+        if (!cv::imwrite(framePath(dir, "calibration", i), calibration.calibration[i])) return false;
+    }
+    for (size_t i = 0; i < calibration.validation.size(); i++) {
+        if (!cv::imwrite(framePath(dir, "validation", i), calibration.validation[i])) return false;
+    }
+    cv::FileStorage fs(dir + "/reference.yml", cv::FileStorage::WRITE);
+    if (!fs.isOpened()) return false;
+    fs << "calibration_frames" << (int)calibration.calibration.size();
+    fs << "validation_frames" << (int)calibration.validation.size();
+    fs << "reference_wrists" << calibration.reference;
+    return true;
+}
+
+bool poseCalibrationLoad(const std::string& dir, PoseCalibration& calibration) {
+    cv::FileStorage fs(dir + "/reference.yml", cv::FileStorage::READ);
+    if (!fs.isOpened()) return false;
+    int calibrationFrames = 0, validationFrames = 0;
+    fs["calibration_frames"] >> calibrationFrames;
+    fs["validation_frames"] >> validationFrames;
+    fs["reference_wrists"] >> calibration.reference;
+    if (calibration.reference.rows != validationFrames || calibration.reference.cols != 6) return false;
+
+    calibration.calibration.clear();
+    calibration.validation.clear();
+    for (int i = 0; i < calibrationFrames; i++) {
+        calibration.calibration.push_back(cv::imread(framePath(dir, "calibration", i)));
+        if (calibration.calibration.back().empty()) return false;
+    }
+    for (int i = 0; i < validationFrames; i++) {
+        calibration.validation.push_back(cv::imread(framePath(dir, "validation", i)));
+        if (calibration.validation.back().empty()) return false;
+    }
+    return calibrationFrames > 0 && validationFrames > 0;
+}
+
+WristAccuracy poseCheckWrists(cv::dnn::Net& net, const PoseCalibration& calibration) {
+    WristAccuracy accuracy;
+    int agreed = 0, matched = 0, total = 0;
+    double errorSum = 0;
+    for (size_t i = 0; i < calibration.validation.size(); i++) {
+        float wrists[6];
+        forwardWrists(net, calibration.validation[i], wrists);
+        const float* reference = calibration.reference.ptr<float>((int)i);
+        for (int w = 0; w < 2; w++) {
+            bool referenceSeen = reference[w * 3 + 2] > INT8_WRIST_CONFIDENCE;
+            bool seen = wrists[w * 3 + 2] > INT8_WRIST_CONFIDENCE;
+            total++;
+            if (referenceSeen == seen) agreed++;
+            if (referenceSeen) accuracy.wrists++;
+            if (!referenceSeen || !seen) continue;
+            float error = std::hypot(wrists[w * 3] - reference[w * 3], wrists[w * 3 + 1] - reference[w * 3 + 1]);
+            errorSum += error;
+            accuracy.maxError = std::max(accuracy.maxError, error);
+            matched++;
+        }
+    }
+    accuracy.meanError = matched > 0 ? (float)(errorSum / matched) : 0;
+    accuracy.agreement = total > 0 ? (float)agreed / total : 0;
+    accuracy.passed = accuracy.wrists > 0 && accuracy.agreement >= INT8_MIN_AGREEMENT &&
+                      accuracy.meanError <= INT8_MAX_MEAN_ERROR;
+    return accuracy;
+}
+
+bool poseQuantize(cv::dnn::Net& net, const PoseCalibration& calibration, WristAccuracy& accuracy) {
+    accuracy = WristAccuracy();
+    std::vector<cv::Mat> blobs;
+    for (const cv::Mat& frame : calibration.calibration) {
+        blobs.push_back(framePoseBlob(frame).clone());
+    }
+
+    cv::dnn::Net quantized;
+    try {
+        quantized = net.quantize(blobs, CV_32F, CV_32F);
+        quantized.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        quantized.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+        accuracy = poseCheckWrists(quantized, calibration);
+    } catch (const cv::Exception& e) {
+        std::cerr << "Could not quantize the pose network: " << e.what() << std::endl;
+        return false;
+    }
+    if (!accuracy.passed) return false;
+    net = quantized;
+    return true;
+}
+
+void poseAccuracyPrint(const WristAccuracy& accuracy) {
+    std::cout << "INT8 wrist check: " << accuracy.wrists << " wrists, mean error " << accuracy.meanError
+              << " (max " << accuracy.maxError << ", limit " << INT8_MAX_MEAN_ERROR << "), agreement "
+              << accuracy.agreement * 100 << "% (limit " << INT8_MIN_AGREEMENT * 100 << "%): "
+              << (accuracy.passed ? "passed" : "FAILED") << std::endl;
+}
+
+bool poseUseInt8(cv::dnn::Net& net) {
+    PoseCalibration calibration;
+    if (!poseCalibrationLoad(POSE_INT8_CALIBRATION_DIR, calibration)) {
+        std::cout << "No INT8 calibration in " << POSE_INT8_CALIBRATION_DIR
+                  << " (run calibrate_pose). Using the FP32 pose network." << std::endl;
+        return false;
+    }
+    WristAccuracy accuracy;
+    bool quantized = poseQuantize(net, calibration, accuracy);
+    poseAccuracyPrint(accuracy);
+    std::cout << (quantized ? "Using the INT8 pose network." : "Using the FP32 pose network.") << std::endl;
+    return quantized;
+}
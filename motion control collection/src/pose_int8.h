@@ -0,0 +1,60 @@
+#ifndef POSE_INT8_H
+#define POSE_INT8_H
+
+#include "common.h"
+#include <string>
+
+// Optional INT8 pose network, built at startup with OpenCV's Net::quantize.
+// calibrate_pose picks frames from a recording of real players and stores
+// them, already at the pose input size, in POSE_INT8_CALIBRATION_DIR: most
+// are used to gather activation ranges, the rest are held out together with
+// the wrist positions the FP32 network found in them. Before a quantized
+// network replaces the FP32 one it must find the same wrists in the held-out
+// frames; otherwise the FP32 network stays in service.
+const char* const POSE_INT8_CALIBRATION_DIR = "models/int8_calibration";
+const int INT8_CALIBRATION_FRAMES = 48;
+const int INT8_VALIDATION_EVERY = 3;          // every third frame is held out
+const float INT8_WRIST_CONFIDENCE = 0.1f;     // same threshold the detector uses
+const float INT8_MAX_MEAN_ERROR = 0.02f;      // mean wrist distance, fraction of the frame
+const float INT8_MIN_AGREEMENT = 0.95f;       // share of wrists both networks see or both miss
+
+struct PoseCalibration {
+    std::vector<cv::Mat> calibration;   // frames for activation ranges
+    std::vector<cv::Mat> validation;    // held-out frames
+    cv::Mat reference;                  // FP32 wrists per validation frame: right x, y, conf, left x, y, conf
+};
+
+struct WristAccuracy {
+    int wrists = 0;           // wrists the FP32 network saw
+    float meanError = 0;
+    float maxError = 0;
+    float agreement = 0;
+    bool passed = false;
+};
+
+// Right and left wrist (x, y, confidence) in unmirrored frame coordinates,
+// from a network output.
+void poseWrists(cv::Mat& output, float wrists[6]);
+
+// Picks up to maxFrames frames spread evenly over a video or image directory
+// and splits them into calibration and validation sets. The reference wrists
+// come from the given FP32 network.
+bool poseCalibrationCollect(const std::string& input, int maxFrames, cv::dnn::Net& net,
+                            PoseCalibration& calibration);
+bool poseCalibrationSave(const std::string& dir, const PoseCalibration& calibration);
+bool poseCalibrationLoad(const std::string& dir, PoseCalibration& calibration);
+
+WristAccuracy poseCheckWrists(cv::dnn::Net& net, const PoseCalibration& calibration);
+
+// Quantizes net with the calibration frames and checks the result against
+// the reference wrists. net is replaced only if the check passes.
+bool poseQuantize(cv::dnn::Net& net, const PoseCalibration& calibration, WristAccuracy& accuracy);
+
+void poseAccuracyPrint(const WristAccuracy& accuracy);
+
+// Startup path for --pose-backend int8: loads the stored calibration and
+// quantizes net with it, reporting the check. Returns false and leaves the
+// FP32 network in place when there is no calibration or the check fails.
+bool poseUseInt8(cv::dnn::Net& net);
+
+#endif
@@ -0,0 +1,72 @@
+#include "pose_model.h"
+#include <chrono>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only private mapping of a whole file, unmapped when it goes out of
+// scope. The parsed network owns its own copy of the weights, so the mapping
+// only has to outlive the readNetFromCaffe call.
+class MappedFile {
+public:
+    ~MappedFile() {
+        if (data) munmap((void*)data, size);
+    }
+
+    bool open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+        void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            std::cerr << "Could not map " << path << std::endl;
+            return false;
+        }
+        madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+        data = (const char*)mapped;
+        size = st.st_size;
+        return true;
+    }
+
+    const char* data = nullptr;
+    size_t size = 0;
+};
+
+static bool fileExists(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+bool poseModelShrink(const std::string& weights, const std::string& out) {
+    if (!fileExists(weights)) {
+        std::cerr << "Model weights not found: " << weights << std::endl;
+        return false;
+    }
+    try {
+        cv::dnn::shrinkCaffeModel(weights, out);
+    } catch (const cv::Exception& e) {
+        std::cerr << "Could not convert " << weights << ": " << e.what() << std::endl;
+        return false;
+    }
+    return fileExists(out);
+}
+
+bool poseModelLoad(cv::dnn::Net& net, std::string& weightsPath) {
+    weightsPath = fileExists(POSE_WEIGHTS_FP16_FILE) ? POSE_WEIGHTS_FP16_FILE : POSE_WEIGHTS_FILE;
+
+    MappedFile proto, weights;
+    if (!proto.open(POSE_PROTO_FILE) || !weights.open(weightsPath)) return false;
+
+    auto start = std::chrono::steady_clock::now();
+    net = cv::dnn::readNetFromCaffe(proto.data, proto.size, weights.data, weights.size);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Loaded " << weightsPath << " (" << weights.size / (1024 * 1024) << " MB) in "
+              << (int)ms << " ms" << std::endl;
+    return !net.empty();
+}
@@ -0,0 +1,23 @@
+#ifndef POSE_MODEL_H
+#define POSE_MODEL_H
+
+#include "common.h"
+#include <string>
+
+// OpenPose COCO model files. shrink_model converts the convolution weights of
+// the original caffemodel to FP16 once, halving the file. At startup the
+// compact file is preferred; both files are memory-mapped and parsed straight
+// out of the mapping, so the weights are never copied into a read buffer
+// first and the file pages stay in the shared page cache between launches.
+const char* const POSE_PROTO_FILE = "models/openpose_pose_coco.prototxt";
+const char* const POSE_WEIGHTS_FILE = "models/pose_iter_440000.caffemodel";
+const char* const POSE_WEIGHTS_FP16_FILE = "models/pose_iter_440000_fp16.caffemodel";
+
+bool poseModelShrink(const std::string& weights, const std::string& out);
+
+// Loads the network from the compact weights if present, the original ones
+// otherwise. weightsPath receives the file that was used. Throws
+// cv::Exception if the files exist but cannot be parsed.
+bool poseModelLoad(cv::dnn::Net& net, std::string& weightsPath);
+
+#endif
@@ -0,0 +1,236 @@
+#include "pose_pipeline.h"
+#include "pose_model.h"
+#include "pose_int8.h"
+#include "trace.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+typedef std::chrono::steady_clock PipelineClock;
+
+static const int LATENCY_BINS = 2000;   // 1 ms each; slower results land in the last bin
+
+enum SlotState { SLOT_FREE, SLOT_QUEUED, SLOT_RUNNING, SLOT_DONE };
+
+struct PipelineSlot {
+    SlotState state = SLOT_FREE;
+    long sequence = 0;
+    Uint32 captureTicks = 0;
+    cv::Mat blob;
+    Keypoint keypoints[NUM_KEYPOINTS] = {};
+    PipelineClock::time_point submitted;
+};
+
+static bool active = false;
+static std::vector<cv::dnn::Net> nets;
+static std::vector<std::thread> workers;
+
+// Slot states and sequence numbers are guarded by the mutex. A free slot's
+// data belongs to the main thread, a queued or running one to the worker
+// that picks it up, and a done one to the main thread again.
+static std::vector<PipelineSlot> slots;
+static std::mutex mutex;
+static std::condition_variable work, finished;
+static bool stopping = false;
+static long nextSequence = 0;
+static long nextRelease = 0;
+static int reserved = -1;
+
+static long framesSubmitted = 0;
+static long framesDropped = 0;
+static long resultsTaken = 0;
+static long resultsHeld = 0;
+static double forwardMs = 0;
+static double latencyTotalMs = 0;
+static std::vector<long> latencyBins;
+static PipelineClock::time_point firstSubmit, lastTake;
+
+static double elapsedMs(PipelineClock::time_point from, PipelineClock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// Called with the mutex held.
+static int findSlot(SlotState state, long sequence) {
+    int found = -1;
+    for (int i = 0; i < (int)slots.size(); i++) {
+        if (slots[i].state != state) continue;
+        if (sequence >= 0 ? slots[i].sequence == sequence
+                          : found < 0 || slots[i].sequence < slots[found].sequence) {
+            found = i;
+        }
+    }
+    return found;
+}
+
+static bool earlierPending(long sequence) {
+    for (const PipelineSlot& slot : slots) {
+        if ((slot.state == SLOT_QUEUED || slot.state == SLOT_RUNNING) && slot.sequence < sequence) return true;
+    }
+    return false;
+}
+
+static void workerLoop(int index) {
+    traceSetThreadName("pose-worker");
+    cv::dnn::Net& net = nets[index];
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        int s = findSlot(SLOT_QUEUED, -1);
+        if (s < 0) {
+            if (stopping) return;
+            work.wait(lock);
+            continue;
+        }
+        PipelineSlot& slot = slots[s];
+        slot.state = SLOT_RUNNING;
+        lock.unlock();
+
+        PipelineClock::time_point start = PipelineClock::now();
+        {
+            TRACE_SCOPE("inference");
+            net.setInput(slot.blob);
+            cv::Mat output = net.forward();
+            keypointsFromHeatmaps(output, slot.keypoints);
+        }
+        double ms = elapsedMs(start, PipelineClock::now());
+
+        lock.lock();
+        forwardMs += ms;
+        if (earlierPending(slot.sequence)) resultsHeld++;
+        slot.state = SLOT_DONE;
+        finished.notify_all();
+    }
+}
+
+static bool loadNet(cv::dnn::Net& net, const PoseCalibration* calibration) {
+    try {
+        std::string weightsPath;
+        if (!poseModelLoad(net, weightsPath)) return false;
+        net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+        WristAccuracy accuracy;
+        return !calibration || poseQuantize(net, *calibration, accuracy);
+    } catch (const cv::Exception& e) {
+        std::cerr << "Failed to load a pose network for the pipeline: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool posePipelineStart(const cv::dnn::Net& net, int depth, bool int8) {
+    depth = std::max(1, std::min(POSE_PIPELINE_MAX_DEPTH, depth));
+    PoseCalibration calibration;
+    if (int8 && depth > 1 && !poseCalibrationLoad(POSE_INT8_CALIBRATION_DIR, calibration)) {
+        std::cerr << "Could not load the INT8 calibration for the pose pipeline." << std::endl;
+        return false;
+    }
+    nets.assign(1, net);
+    for (int i = 1; i < depth; i++) {
+        cv::dnn::Net copy;
+        if (!loadNet(copy, int8 ? &calibration : nullptr)) {
+            std::cerr << "Could not load pose network " << i + 1 << " of " << depth
+                      << "; pipelined inference is off." << std::endl;
+            nets.clear();
+            return false;
+        }
+        nets.push_back(copy);
+    }
+
+    slots.assign(depth, PipelineSlot());
+    stopping = false;
+    nextSequence = nextRelease = 0;
+    reserved = -1;
+    framesSubmitted = framesDropped = resultsTaken = resultsHeld = 0;
+    forwardMs = latencyTotalMs = 0;
+    latencyBins.assign(LATENCY_BINS, 0);
+
+    for (int i = 0; i < depth; i++) workers.emplace_back(workerLoop, i);
+    active = true;
+    std::cout << "Pose pipeline: " << depth << " networks in flight, OpenCV pool of " << cv::getNumThreads()
+              << " thread(s)" << std::endl;
+    return true;
+}
+
+bool posePipelineActive() {
+    return active;
+}
+
+int posePipelineDepth() {
+    return active ? (int)nets.size() : 1;
+}
+
+bool posePipelineReserve() {
+    if (!active) return false;
+    if (reserved >= 0) return true;
+    std::lock_guard<std::mutex> lock(mutex);
+    reserved = findSlot(SLOT_FREE, -1);
+    if (reserved < 0) framesDropped++;
+    return reserved >= 0;
+}
+
+void posePipelineSubmit(const cv::Mat& blob, Uint32 captureTicks) {
+    if (!posePipelineReserve()) return;
+    PipelineSlot& slot = slots[reserved];
+    blob.copyTo(slot.blob);
+    slot.captureTicks = captureTicks;
+    slot.submitted = PipelineClock::now();
+    if (framesSubmitted == 0) firstSubmit = slot.submitted;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        slot.sequence = nextSequence++;
+        slot.state = SLOT_QUEUED;
+    }
+    framesSubmitted++;
+    reserved = -1;
+    work.notify_one();
+}
+
+bool posePipelineTake(PoseResult& result, bool wait) {
+    if (!active) return false;
+    std::unique_lock<std::mutex> lock(mutex);
+    int s;
+    while (true) {
+        if (nextRelease == nextSequence) return false;
+        s = findSlot(SLOT_DONE, nextRelease);
+        if (s >= 0) break;
+        if (!wait) return false;
+        finished.wait(lock);
+    }
+    PipelineSlot& slot = slots[s];
+    result.captureTicks = slot.captureTicks;
+    std::copy(slot.keypoints, slot.keypoints + NUM_KEYPOINTS, result.keypoints);
+    lastTake = PipelineClock::now();
+    result.latencyMs = elapsedMs(slot.submitted, lastTake);
+    slot.state = SLOT_FREE;
+    nextRelease++;
+
+    resultsTaken++;
+    latencyTotalMs += result.latencyMs;
+    latencyBins[std::min(LATENCY_BINS - 1, (int)result.latencyMs)]++;
+    return true;
+}
+
+void posePipelineStop() {
+    if (!active) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work.notify_all();
+    for (std::thread& worker : workers) worker.join();
+    workers.clear();
+    nets.clear();
+    active = false;
+
+    std::cout << "Pose pipeline: " << slots.size() << " networks, " << resultsTaken << " poses from "
+              << framesSubmitted << " frames, " << framesDropped << " frames dropped with every network busy"
+              << std::endl;
+    if (resultsTaken == 0) return;
+    long p95Index = (long)(resultsTaken * 0.95), seen = 0;
+    int p95 = 0;
+    while (p95 < LATENCY_BINS - 1 && seen + latencyBins[p95] <= p95Index) seen += latencyBins[p95++];
+    double seconds = elapsedMs(firstSubmit, lastTake) / 1000.0;
+    std::cout << "  " << (seconds > 0 ? resultsTaken / seconds : 0) << " poses/s, forward mean "
+              << forwardMs / framesSubmitted << " ms, submit to result mean " << latencyTotalMs / resultsTaken
+              << " ms (p95 " << p95 + 1 << " ms), " << resultsHeld << " finished before an earlier frame"
+              << std::endl;
+}
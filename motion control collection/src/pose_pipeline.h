@@ -0,0 +1,45 @@
+#ifndef POSE_PIPELINE_H
+#define POSE_PIPELINE_H
+
+#include "common.h"
+
+// Pipelined pose inference for machines with many cores. A single
+// net.forward() stops scaling well past a few threads, so instead of one
+// network spread over every core, K copies of the network each run on their
+// own worker thread and up to K camera frames are in flight at once. A frame
+// that arrives while every network is busy is dropped, which bounds the
+// latency to about one inference plus the wait for earlier frames. Results
+// are handed back strictly in capture order, whichever network finishes
+// first. OpenCV has one worker pool per process and a forward() that finds
+// it busy runs on its own thread alone, so the pool keeps its full size:
+// one network at a time spreads over it while the others use their worker
+// threads, and together they keep the cores busy.
+const int POSE_PIPELINE_MAX_DEPTH = 16;
+
+struct PoseResult {
+    Uint32 captureTicks;                  // session time the frame was captured
+    Keypoint keypoints[NUM_KEYPOINTS];    // mirrored, as PoseDetector stores them
+    double latencyMs;                     // from submit to take
+};
+
+// net becomes the first worker's network; the other depth - 1 are loaded
+// from the model files again and quantized like it when int8 is set.
+bool posePipelineStart(const cv::dnn::Net& net, int depth, bool int8);
+bool posePipelineActive();
+int posePipelineDepth();
+
+// Main thread. Reserve claims a free network for the next frame and returns
+// false, counting the frame as dropped, when all of them are busy. Submit
+// copies the blob into the reserved slot and queues it.
+bool posePipelineReserve();
+void posePipelineSubmit(const cv::Mat& blob, Uint32 captureTicks);
+
+// Takes the oldest submitted frame once its result is ready. With wait set,
+// blocks until it is; returns false when nothing is in flight.
+bool posePipelineTake(PoseResult& result, bool wait = false);
+
+// Finishes the frames in flight, stops the workers and prints throughput
+// and latency.
+void posePipelineStop();
+
+#endif
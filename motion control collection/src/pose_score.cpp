@@ -0,0 +1,122 @@
+#include "pose_score.h"
+#include <limits>
+
+static const float MIN_CONFIDENCE = 0.1f;
+static const float IMAGE_TORSO_LENGTH = 0.3f;
+static const float NO_MATCH_DISTANCE = 1000.0f;
+static const int SUM_WIDTH = 8;
+
+static bool seen(const Keypoint& k) {
+    return k.confidence > MIN_CONFIDENCE;
+}
+
+static bool torsoFrame(const Keypoint* keypoints, float& originX, float& originY, float& scale) {
+    const Keypoint& neck = keypoints[POSE_NECK];
+    const Keypoint& leftHip = keypoints[POSE_LEFT_HIP];
+    const Keypoint& rightHip = keypoints[POSE_RIGHT_HIP];
+    if (!seen(neck) || (!seen(leftHip) && !seen(rightHip))) return false;
+
+    float hipX, hipY;
+    if (seen(leftHip) && seen(rightHip)) {
+        hipX = (leftHip.x + rightHip.x) / 2;
+        hipY = (leftHip.y + rightHip.y) / 2;
+    } else {
+        const Keypoint& hip = seen(leftHip) ? leftHip : rightHip;
+        hipX = hip.x;
+        hipY = hip.y;
+    }
+    scale = std::sqrt((hipX - neck.x) * (hipX - neck.x) + (hipY - neck.y) * (hipY - neck.y));
+    originX = neck.x;
+    originY = neck.y;
+    return scale > 0.01f;
+}
+
+void poseFeatureFromKeypoints(const Keypoint* keypoints, bool torsoRelative, PoseFeature& feature) {
+    float originX, originY, scale;
+    feature.torsoRelative = torsoRelative && torsoFrame(keypoints, originX, originY, scale);
+    if (!feature.torsoRelative) {
+        originX = 0.5f;
+        originY = 0.5f;
+        scale = IMAGE_TORSO_LENGTH;
+    }
+    for (int i = 0; i < POSE_LANES; i++) {
+        if (i < NUM_KEYPOINTS && seen(keypoints[i])) {
+            feature.x[i] = (keypoints[i].x - originX) / scale;
+            feature.y[i] = (keypoints[i].y - originY) / scale;
+            feature.weight[i] = keypoints[i].confidence;
+        } else {
+            feature.x[i] = 0;
+            feature.y[i] = 0;
+            feature.weight[i] = 0;
+        }
+    }
+}
+
+void poseFeatureLerp(const PoseFeature& a, const PoseFeature& b, float f, PoseFeature& out) {
+    if (a.torsoRelative != b.torsoRelative) {
+        out = f < 0.5f ? a : b;
+        return;
+    }
+    out.torsoRelative = a.torsoRelative;
+    for (int i = 0; i < POSE_LANES; i++) {
+        out.x[i] = a.x[i] + (b.x[i] - a.x[i]) * f;
+        out.y[i] = a.y[i] + (b.y[i] - a.y[i]) * f;
+        out.weight[i] = std::min(a.weight[i], b.weight[i]);
+    }
+}
+
+// Eight independent partial sums keep the inner loop free of a serial
+// dependency, so it compiles to packed multiplies and adds.
+float poseDistance(const PoseFeature& observed, const PoseFeature& candidate) {
+    float sum[SUM_WIDTH] = {};
+    float total[SUM_WIDTH] = {};
+    for (int i = 0; i < POSE_LANES; i += SUM_WIDTH) {
+        for (int j = 0; j < SUM_WIDTH; j++) {
+            float w = observed.weight[i + j] * candidate.weight[i + j];
+            float dx = observed.x[i + j] - candidate.x[i + j];
+            float dy = observed.y[i + j] - candidate.y[i + j];
+            sum[j] += w * (dx * dx + dy * dy);
+            total[j] += w;
+        }
+    }
+    float s = 0, t = 0;
+    for (int j = 0; j < SUM_WIDTH; j++) {
+        s += sum[j];
+        t += total[j];
+    }
+    return t > 0 ? std::sqrt(s / t) : NO_MATCH_DISTANCE;
+}
+
+float poseSequenceDistance(const std::vector<PoseFeature>& observed,
+                           const std::vector<const PoseFeature*>& target, int band) {
+    int n = (int)observed.size();
+    int m = (int)target.size();
+    if (n == 0 || m == 0 || std::abs(n - m) > band) return NO_MATCH_DISTANCE;
+
+    const float inf = std::numeric_limits<float>::infinity();
+    std::vector<float> cost((n + 1) * (m + 1), inf);
+    std::vector<int> length((n + 1) * (m + 1), 0);
+    cost[0] = 0;
+    for (int i = 1; i <= n; i++) {
+        for (int j = std::max(1, i - band); j <= std::min(m, i + band); j++) {
+            int diag = (i - 1) * (m + 1) + (j - 1);
+            int up = (i - 1) * (m + 1) + j;
+            int left = i * (m + 1) + (j - 1);
+            int best = diag;
+            if (cost[up] < cost[best]) best = up;
+            if (cost[left] < cost[best]) best = left;
+            if (cost[best] == inf) continue;
+
+            int cell = i * (m + 1) + j;
+            cost[cell] = cost[best] + poseDistance(observed[i - 1], *target[j - 1]);
+            length[cell] = length[best] + 1;
+        }
+    }
+    int end = n * (m + 1) + m;
+    return length[end] > 0 ? cost[end] / length[end] : NO_MATCH_DISTANCE;
+}
+
+float poseSimilarity(float distance) {
+    float r = distance / POSE_MATCH_DISTANCE;
+    return 1.0f / (1.0f + r * r);
+}
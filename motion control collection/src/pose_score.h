@@ -0,0 +1,38 @@
+#ifndef POSE_SCORE_H
+#define POSE_SCORE_H
+
+#include "common.h"
+
+// Whole-body pose comparison. Keypoints are moved into a body frame centred on
+// the neck and scaled by torso length, so distance from the camera and
+// position in the frame do not matter. When the torso is not visible (motion
+// fallback) or torsoRelative is false, the image centre and a typical torso
+// size stand in for it. Features are stored as padded arrays so a comparison
+// is a straight loop over whole vectors.
+const int POSE_LANES = 24;
+const float POSE_MATCH_DISTANCE = 0.6f;
+
+struct PoseFeature {
+    bool torsoRelative = false;
+    alignas(32) float x[POSE_LANES] = {};
+    alignas(32) float y[POSE_LANES] = {};
+    alignas(32) float weight[POSE_LANES] = {};
+};
+
+void poseFeatureFromKeypoints(const Keypoint* keypoints, bool torsoRelative, PoseFeature& feature);
+void poseFeatureLerp(const PoseFeature& a, const PoseFeature& b, float f, PoseFeature& out);
+
+// Weighted RMS distance in torso lengths; candidate weights say how much each
+// body part matters, observed weights whether it was seen.
+float poseDistance(const PoseFeature& observed, const PoseFeature& candidate);
+
+// Dynamic time warping between an observed sequence and a target sequence of
+// the same sample spacing, allowing moves up to band samples early or late.
+// Returns the mean distance along the best alignment.
+float poseSequenceDistance(const std::vector<PoseFeature>& observed,
+                           const std::vector<const PoseFeature*>& target, int band);
+
+// 1 for an exact match, 0.5 at POSE_MATCH_DISTANCE.
+float poseSimilarity(float distance);
+
+#endif
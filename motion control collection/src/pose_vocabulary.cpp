@@ -0,0 +1,241 @@
+#include "pose_vocabulary.h"
+#include <queue>
+#include <sstream>
+
+static const int TORSO_INDEX_PARTS[] = {POSE_LEFT_WRIST, POSE_RIGHT_WRIST, POSE_LEFT_ELBOW, POSE_RIGHT_ELBOW};
+static const int IMAGE_INDEX_PARTS[] = {POSE_LEFT_WRIST, POSE_RIGHT_WRIST};
+static const int TORSO_INDEX_DIMS = 8;
+static const int IMAGE_INDEX_DIMS = 4;
+
+void KdTree::build(const std::vector<float>& data, int numDims) {
+    dims = numDims;
+    points = data;
+    nodes.clear();
+    order.resize(points.size() / dims);
+    for (size_t i = 0; i < order.size(); i++) order[i] = (int)i;
+    if (!order.empty()) buildNode(0, (int)order.size());
+}
+
+// Splits on the axis with the widest spread, at the median.
+int KdTree::buildNode(int begin, int end) {
+    int index = (int)nodes.size();
+    nodes.push_back({-1, 0, -1, -1, begin, end});
+    if (end - begin <= KD_LEAF_SIZE) return index;
+
+    int axis = 0;
+    float widest = -1;
+    for (int d = 0; d < dims; d++) {
+        float lo = points[order[begin] * dims + d], hi = lo;
+        for (int i = begin + 1; i < end; i++) {
+            float v = points[order[i] * dims + d];
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+        }
+        if (hi - lo > widest) {
+            widest = hi - lo;
+            axis = d;
+        }
+    }
+
+    int mid = (begin + end) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end, [&](int a, int b) {
+        return points[a * dims + axis] < points[b * dims + axis];
+    });
+    float split = points[order[mid] * dims + axis];
+    int left = buildNode(begin, mid);
+    int right = buildNode(mid, end);
+    nodes[index].axis = axis;
+    nodes[index].split = split;
+    nodes[index].left = left;
+    nodes[index].right = right;
+    return index;
+}
+
+// Best-bin-first: buckets are visited nearest first, and the far side of
+// every split passed on the way down is queued with its distance bound.
+void KdTree::nearest(const float* query, int k, std::vector<int>& out) const {
+    out.clear();
+    if (nodes.empty()) return;
+
+    typedef std::pair<float, int> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> bins;
+    std::priority_queue<Entry> best;
+    bins.push({0.0f, 0});
+    int leaves = 0;
+    while (!bins.empty() && leaves < KD_MAX_LEAVES) {
+        Entry bin = bins.top();
+        bins.pop();
+        if ((int)best.size() == k && bin.first >= best.top().first) break;
+
+        int n = bin.second;
+        while (nodes[n].axis >= 0) {
+            const Node& node = nodes[n];
+            float diff = query[node.axis] - node.split;
+            bins.push({std::max(bin.first, diff * diff), diff < 0 ? node.right : node.left});
+            n = diff < 0 ? node.left : node.right;
+        }
+        leaves++;
+
+        for (int i = nodes[n].begin; i < nodes[n].end; i++) {
+            const float* p = &points[order[i] * dims];
+            float d = 0;
+            for (int j = 0; j < dims; j++) d += (p[j] - query[j]) * (p[j] - query[j]);
+            if ((int)best.size() < k) {
+                best.push({d, order[i]});
+            } else if (d < best.top().first) {
+                best.pop();
+                best.push({d, order[i]});
+            }
+        }
+    }
+
+    out.resize(best.size());
+    for (int i = (int)best.size() - 1; i >= 0; i--) {
+        out[i] = best.top().second;
+        best.pop();
+    }
+}
+
+static float partImportance(int part) {
+    if (part == POSE_LEFT_WRIST || part == POSE_RIGHT_WRIST) return 1.0f;
+    if (part == POSE_LEFT_ELBOW || part == POSE_RIGHT_ELBOW) return 0.6f;
+    return 0.2f;
+}
+
+bool PoseVocabulary::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in.good()) return false;
+
+    std::string line;
+    int lineNumber = 0;
+    size_t before = poses.size();
+    while (std::getline(in, line)) {
+        lineNumber++;
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line[start] == '#') continue;
+
+        size_t bar = line.find('|');
+        std::string name = bar == std::string::npos ? "" : line.substr(start, bar - start);
+        name.erase(name.find_last_not_of(" \t") + 1);
+        std::istringstream values(bar == std::string::npos ? "" : line.substr(bar + 1));
+        Keypoint keypoints[NUM_KEYPOINTS];
+        bool ok = !name.empty();
+        for (int i = 0; i < NUM_KEYPOINTS && ok; i++) {
+            std::string x, y;
+            ok = (bool)(values >> x >> y);
+            if (!ok) break;
+            if (x == "-" || y == "-") {
+                keypoints[i] = {0, 0, 0};
+            } else {
+                keypoints[i] = {std::strtof(x.c_str(), nullptr), std::strtof(y.c_str(), nullptr), 1.0f};
+            }
+        }
+        if (!ok) {
+            std::cerr << path << ":" << lineNumber << ": expected NAME | followed by "
+                      << NUM_KEYPOINTS << " x y pairs" << std::endl;
+            poses.resize(before);
+            return false;
+        }
+        add(name, keypoints);
+    }
+    std::cout << "Pose vocabulary: " << poses.size() - before << " poses from " << path << std::endl;
+    return poses.size() > before;
+}
+
+void PoseVocabulary::add(const std::string& name, const Keypoint* keypoints) {
+    VocabularyPose pose;
+    pose.name = name;
+    for (int i = 0; i < NUM_KEYPOINTS; i++) {
+        pose.keypoints[i] = keypoints[i];
+        if (keypoints[i].confidence > 0) pose.keypoints[i].confidence = partImportance(i);
+    }
+    poseFeatureFromKeypoints(pose.keypoints, true, pose.torso);
+    poseFeatureFromKeypoints(pose.keypoints, false, pose.image);
+    poses.push_back(pose);
+}
+
+// A standing body with the given hands and the elbows half way. The left
+// hand is the player's own, on the left of the screen.
+void PoseVocabulary::addHandsPose(const std::string& name, float leftX, float leftY, float rightX, float rightY) {
+    Keypoint keypoints[NUM_KEYPOINTS] = {
+        {0.50f, 0.22f, 1}, {0.50f, 0.35f, 1},
+        {0.58f, 0.35f, 1}, {0, 0, 1}, {rightX, rightY, 1},
+        {0.42f, 0.35f, 1}, {0, 0, 1}, {leftX, leftY, 1},
+        {0.55f, 0.65f, 1}, {0.55f, 0.80f, 1}, {0.55f, 0.95f, 1},
+        {0.45f, 0.65f, 1}, {0.45f, 0.80f, 1}, {0.45f, 0.95f, 1},
+        {0.52f, 0.20f, 1}, {0.48f, 0.20f, 1}, {0.54f, 0.21f, 1}, {0.46f, 0.21f, 1},
+    };
+    keypoints[POSE_LEFT_ELBOW].x = (keypoints[POSE_LEFT_SHOULDER].x + leftX) / 2;
+    keypoints[POSE_LEFT_ELBOW].y = (keypoints[POSE_LEFT_SHOULDER].y + leftY) / 2;
+    keypoints[POSE_RIGHT_ELBOW].x = (keypoints[POSE_RIGHT_SHOULDER].x + rightX) / 2;
+    keypoints[POSE_RIGHT_ELBOW].y = (keypoints[POSE_RIGHT_SHOULDER].y + rightY) / 2;
+    add(name, keypoints);
+}
+
+// Arm points the feature does not have are replaced by the vocabulary mean,
+// which leaves that dimension neutral for the search.
+static void indexVector(const PoseFeature& feature, const int* parts, int numParts,
+                        const std::vector<float>& mean, float* out) {
+    for (int i = 0; i < numParts; i++) {
+        bool present = feature.weight[parts[i]] > 0 || mean.empty();
+        out[i * 2] = present ? feature.x[parts[i]] : mean[i * 2];
+        out[i * 2 + 1] = present ? feature.y[parts[i]] : mean[i * 2 + 1];
+    }
+}
+
+static void buildPartIndex(const std::vector<VocabularyPose>& poses, bool torso, const int* parts, int numParts,
+                           std::vector<float>& mean, KdTree& index) {
+    int dims = numParts * 2;
+    mean.clear();
+    std::vector<float> sum(dims, 0.0f), count(dims, 0.0f);
+    for (const VocabularyPose& pose : poses) {
+        const PoseFeature& feature = torso ? pose.torso : pose.image;
+        for (int i = 0; i < numParts; i++) {
+            if (feature.weight[parts[i]] <= 0) continue;
+            sum[i * 2] += feature.x[parts[i]];
+            sum[i * 2 + 1] += feature.y[parts[i]];
+            count[i * 2] += 1;
+            count[i * 2 + 1] += 1;
+        }
+    }
+    for (int d = 0; d < dims; d++) sum[d] = count[d] > 0 ? sum[d] / count[d] : 0;
+    mean = sum;
+
+    std::vector<float> points(poses.size() * dims);
+    for (size_t p = 0; p < poses.size(); p++) {
+        indexVector(torso ? poses[p].torso : poses[p].image, parts, numParts, mean, &points[p * dims]);
+    }
+    index.build(points, dims);
+}
+
+void PoseVocabulary::buildIndex() {
+    buildPartIndex(poses, true, TORSO_INDEX_PARTS, TORSO_INDEX_DIMS / 2, torsoMean, torsoIndex);
+    buildPartIndex(poses, false, IMAGE_INDEX_PARTS, IMAGE_INDEX_DIMS / 2, imageMean, imageIndex);
+}
+
+int PoseVocabulary::classify(const PoseFeature& observed, float& similarity) const {
+    similarity = 0;
+    if (poses.empty()) return -1;
+
+    float query[TORSO_INDEX_DIMS];
+    std::vector<int> candidates;
+    if (observed.torsoRelative) {
+        indexVector(observed, TORSO_INDEX_PARTS, TORSO_INDEX_DIMS / 2, torsoMean, query);
+        torsoIndex.nearest(query, VOCABULARY_CANDIDATES, candidates);
+    } else {
+        indexVector(observed, IMAGE_INDEX_PARTS, IMAGE_INDEX_DIMS / 2, imageMean, query);
+        imageIndex.nearest(query, VOCABULARY_CANDIDATES, candidates);
+    }
+
+    int best = -1;
+    float bestDistance = 0;
+    for (int c : candidates) {
+        float d = poseDistance(observed, observed.torsoRelative ? poses[c].torso : poses[c].image);
+        if (best < 0 || d < bestDistance) {
+            best = c;
+            bestDistance = d;
+        }
+    }
+    if (best >= 0) similarity = poseSimilarity(bestDistance);
+    return best;
+}
@@ -0,0 +1,67 @@
+#ifndef POSE_VOCABULARY_H
+#define POSE_VOCABULARY_H
+
+#include "common.h"
+#include "pose_score.h"
+#include <string>
+
+// Static k-d tree over fixed-length vectors. Searches stop after
+// KD_MAX_LEAVES buckets, so a query costs the same however many points are
+// indexed; the result is then the approximate k nearest.
+const int KD_LEAF_SIZE = 8;
+const int KD_MAX_LEAVES = 16;
+
+class KdTree {
+public:
+    void build(const std::vector<float>& points, int dims);
+    void nearest(const float* query, int k, std::vector<int>& out) const;
+
+private:
+    struct Node {
+        int axis;
+        float split;
+        int left, right;
+        int begin, end;
+    };
+    int dims = 0;
+    std::vector<float> points;
+    std::vector<int> order;
+    std::vector<Node> nodes;
+
+    int buildNode(int begin, int end);
+};
+
+// Named body poses. poses/vocabulary.txt holds one pose per line:
+//   NAME | x y  x y  ...
+// with the 18 COCO keypoints of a standing player in image coordinates and
+// "-" for a point the pose leaves free. Poses are indexed by their arm
+// positions and candidates from the index are re-ranked with poseDistance.
+const int VOCABULARY_CANDIDATES = 8;
+
+struct VocabularyPose {
+    std::string name;
+    Keypoint keypoints[NUM_KEYPOINTS];
+    PoseFeature torso;
+    PoseFeature image;
+};
+
+class PoseVocabulary {
+public:
+    bool load(const std::string& path);
+    void add(const std::string& name, const Keypoint* keypoints);
+    void addHandsPose(const std::string& name, float leftX, float leftY, float rightX, float rightY);
+    void buildIndex();
+
+    size_t size() const { return poses.size(); }
+    const VocabularyPose& operator[](size_t i) const { return poses[i]; }
+    int classify(const PoseFeature& observed, float& similarity) const;
+
+private:
+    std::vector<VocabularyPose> poses;
+    KdTree torsoIndex;
+    KdTree imageIndex;
+    std::vector<float> torsoMean;
+    std::vector<float> imageMean;
+};
+
+#endif
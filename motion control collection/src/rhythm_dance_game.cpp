@@ -1,143 +1,348 @@
 #include "rhythm_dance_game.h"
+#include "session.h"
+#include "asset_pack.h"
+#include "audio_engine.h"
+#include "beat_map.h"
+#include "pose_vocabulary.h"
+#include "particles.h"
 
-struct DancePose {
-    std::string name;
-    float leftArmX, leftArmY;
-    float rightArmX, rightArmY;
-    float duration;
+struct PoseSample {
+    double time;
+    PoseFeature feature;
 };
 
-void runRhythmDance(SDL_Renderer* renderer, PoseDetector& poseDetector, cv::VideoCapture& cap,
-                    bool useCamera, cv::Mat& currentFrame, bool& returnToMenu, Mix_Music* bgMusic) {
-    Mix_Music* danceMusic = Mix_LoadMUS("audio and sound effects/rhythm_dance.mp3");
-    if (danceMusic) {
-        Mix_PlayMusic(danceMusic, -1);
-        Mix_VolumeMusic(MIX_MAX_VOLUME / 2);
+struct PendingJudgement {
+    int pose;
+    int nextPose;
+    double end;
+};
+
+static const size_t MAX_POSE_SAMPLES = 64;
+static const size_t MAX_PENDING = 8;        // judgements waiting for JUDGE_LATE to pass
+static const double POSE_SECONDS = 2.0;
+static const double JUDGE_HOLD = 0.5;
+static const double JUDGE_LATE = 0.25;
+static const int JUDGE_STEPS = 16;
+static const int COMBO_MILESTONE = 5;
+static const char* VOCABULARY_PATH = "poses/vocabulary.txt";
+static const char* DANCE_TRACK = "audio and sound effects/rhythm_dance.mp3";
+
+typedef FixedRing<PoseSample, MAX_POSE_SAMPLES> PoseSampleRing;
+
+// Poses last a whole number of bars' worth of beats, whichever is closest to
+// POSE_SECONDS at the song's tempo.
+static int beatsPerPose(const BeatMap& map) {
+    int best = 2;
+    for (int beats : {2, 4, 8}) {
+        if (std::fabs(beats * 60.0 / map.tempo - POSE_SECONDS) < std::fabs(best * 60.0 / map.tempo - POSE_SECONDS)) {
+            best = beats;
+        }
+    }
+    return best;
+}
+
+static double poseEndAfter(const BeatMap& map, double start) {
+    double t = start;
+    for (int i = beatsPerPose(map); i > 0; i--) {
+        t = beatMapNextBeat(map, t + 0.01);
+    }
+    return t;
+}
+
+// Song position in seconds. The audio clock comes through the session, so a
+// replay sees the one that was recorded; without music, session time stands in.
+static double songClock(const GameInput& input, double startTime) {
+    if (input.musicTime >= 0) return input.musicTime;
+    return input.time - startTime;
+}
+
+// Observed pose at song time t, interpolated between the detector samples
+// around it.
+static void poseAt(const PoseSampleRing& samples, double t, const PoseFeature& current, PoseFeature& out) {
+    if (samples.empty()) {
+        out = current;
+        return;
+    }
+    size_t i = 0;
+    while (i < samples.size() && samples[i].time < t) i++;
+    if (i == 0) {
+        out = samples.front().feature;
+    } else if (i == samples.size()) {
+        out = samples.back().feature;
+    } else {
+        const PoseSample& a = samples[i - 1];
+        const PoseSample& b = samples[i];
+        float f = b.time > a.time ? (float)((t - a.time) / (b.time - a.time)) : 1.0f;
+        poseFeatureLerp(a.feature, b.feature, f, out);
     }
-    
-    std::vector<DancePose> poses = {
-        {"ARMS UP", 0.3f, 0.2f, 0.7f, 0.2f, 2.0f},
-        {"ARMS DOWN", 0.3f, 0.8f, 0.7f, 0.8f, 2.0f},
-        {"LEFT HIGH", 0.2f, 0.2f, 0.7f, 0.6f, 2.0f},
-        {"RIGHT HIGH", 0.3f, 0.6f, 0.8f, 0.2f, 2.0f},
-        {"T POSE", 0.1f, 0.5f, 0.9f, 0.5f, 2.0f},
-        {"HANDS CENTER", 0.45f, 0.4f, 0.55f, 0.4f, 2.0f},
+}
+
+static void drawBone(SDL_Renderer* renderer, const Keypoint* keypoints, int from, int to) {
+    if (keypoints[from].confidence <= 0 || keypoints[to].confidence <= 0) return;
+    SDL_RenderDrawLine(renderer, (int)(keypoints[from].x * GAME_WIDTH / 2), (int)(keypoints[from].y * GAME_HEIGHT),
+                       (int)(keypoints[to].x * GAME_WIDTH / 2), (int)(keypoints[to].y * GAME_HEIGHT));
+}
+
+// Stick figure of a vocabulary pose on the left half of the play area.
+static void drawPoseFigure(SDL_Renderer* renderer, const Keypoint* keypoints, const Color& armColor) {
+    static const int BODY_BONES[][2] = {
+        {POSE_NECK, POSE_LEFT_SHOULDER}, {POSE_NECK, POSE_RIGHT_SHOULDER},
+        {POSE_NECK, POSE_LEFT_HIP}, {POSE_NECK, POSE_RIGHT_HIP}, {POSE_LEFT_HIP, POSE_RIGHT_HIP},
+        {POSE_LEFT_HIP, POSE_LEFT_KNEE}, {POSE_LEFT_KNEE, POSE_LEFT_ANKLE},
+        {POSE_RIGHT_HIP, POSE_RIGHT_KNEE}, {POSE_RIGHT_KNEE, POSE_RIGHT_ANKLE},
     };
-    
+    static const int ARM_BONES[][2] = {
+        {POSE_LEFT_SHOULDER, POSE_LEFT_ELBOW}, {POSE_LEFT_ELBOW, POSE_LEFT_WRIST},
+        {POSE_RIGHT_SHOULDER, POSE_RIGHT_ELBOW}, {POSE_RIGHT_ELBOW, POSE_RIGHT_WRIST},
+    };
+
+    SDL_SetRenderDrawColor(renderer, 100, 100, 100, 100);
+    if (keypoints[POSE_NOSE].confidence > 0) {
+        drawFilledCircle(renderer, (int)(keypoints[POSE_NOSE].x * GAME_WIDTH / 2),
+                         (int)(keypoints[POSE_NOSE].y * GAME_HEIGHT), 30);
+    }
+    for (const auto& bone : BODY_BONES) drawBone(renderer, keypoints, bone[0], bone[1]);
+
+    SDL_SetRenderDrawColor(renderer, armColor.r, armColor.g, armColor.b, 200);
+    for (const auto& bone : ARM_BONES) drawBone(renderer, keypoints, bone[0], bone[1]);
+    for (int wrist : {POSE_LEFT_WRIST, POSE_RIGHT_WRIST}) {
+        if (keypoints[wrist].confidence <= 0) continue;
+        drawFilledCircle(renderer, (int)(keypoints[wrist].x * GAME_WIDTH / 2),
+                         (int)(keypoints[wrist].y * GAME_HEIGHT), 20);
+    }
+}
+
+// Compares the moves around a pose boundary with the choreography: the pose
+// for JUDGE_HOLD before it and the next pose after it. Time warping lets the
+// player change pose up to JUDGE_LATE early or late without losing points.
+static float judgePose(const PendingJudgement& judgement, const PoseSampleRing& samples,
+                       const PoseFeature& current, const PoseVocabulary& vocabulary) {
+    double first = judgement.end - JUDGE_HOLD;
+    double step = (JUDGE_HOLD + JUDGE_LATE) / (JUDGE_STEPS - 1);
+    std::vector<PoseFeature> observed(JUDGE_STEPS);
+    std::vector<const PoseFeature*> target(JUDGE_STEPS);
+    for (int i = 0; i < JUDGE_STEPS; i++) {
+        double t = first + step * i;
+        poseAt(samples, t, current, observed[i]);
+        int pose = t < judgement.end ? judgement.pose : judgement.nextPose;
+        target[i] = observed[i].torsoRelative ? &vocabulary[pose].torso : &vocabulary[pose].image;
+    }
+    int band = (int)std::lround(JUDGE_LATE / step);
+    return poseSimilarity(poseSequenceDistance(observed, target, band));
+}
+
+struct RhythmDanceState {
     int score = 0;
     int combo = 0;
     int currentPoseIdx = 0;
-    float poseTimer = 0;
-    float beatTimer = 0;
-    bool running = true;
-    
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> poseDist(0, poses.size() - 1);
-
-    while (running && !returnToMenu) {
-        SDL_Event event;
-        while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_QUIT) { running = false; returnToMenu = false; }
-            else if (event.type == SDL_KEYDOWN) {
-                if (event.key.keysym.sym == SDLK_ESCAPE) returnToMenu = true;
-                if (event.key.keysym.sym == SDLK_q) returnToMenu = true;
+    double poseStart = 0;
+    double poseEnd = 0;
+    PoseSampleRing poseSamples;
+    FixedRing<PendingJudgement, MAX_PENDING> pending;
+    PoseFeature livePose;
+    bool freestyle = false;
+    double freestyleBeat = 0;
+    int lastFreestylePose = -1;
+
+    double songTime = 0;
+    int classified = -1;
+    bool recognised = false;
+    bool poseMatched = false;
+    ParticleSystem particles;
+};
+
+// Every COMBO_MILESTONE poses in a row set off a burst under the combo
+// counter, bigger for longer streaks.
+static void celebrateCombo(RhythmDanceState& s) {
+    if (s.combo % COMBO_MILESTONE != 0) return;
+    float scale = std::min(3.0f, 0.5f + (float)s.combo / (2 * COMBO_MILESTONE));
+    s.particles.burst(GAME_WIDTH / 2.0f, 35.0f, PARTICLES_COMBO, scale);
+}
+
+class RhythmDanceGame : public Game {
+public:
+    explicit RhythmDanceGame(Mix_Music* menuMusic) : menuMusic(menuMusic), state(RhythmDanceState()) {
+        danceMusic = audioAssetMusic(DANCE_TRACK);
+        if (danceMusic) beatMapLoad(DANCE_TRACK, beatMap);
+
+        if (!vocabulary.load(VOCABULARY_PATH)) {
+            vocabulary.addHandsPose("ARMS UP", 0.3f, 0.2f, 0.7f, 0.2f);
+            vocabulary.addHandsPose("ARMS DOWN", 0.3f, 0.8f, 0.7f, 0.8f);
+            vocabulary.addHandsPose("LEFT HIGH", 0.2f, 0.2f, 0.7f, 0.6f);
+            vocabulary.addHandsPose("RIGHT HIGH", 0.3f, 0.6f, 0.8f, 0.2f);
+            vocabulary.addHandsPose("T POSE", 0.1f, 0.5f, 0.9f, 0.5f);
+            vocabulary.addHandsPose("HANDS CENTER", 0.45f, 0.4f, 0.55f, 0.4f);
+        }
+        vocabulary.buildIndex();
+
+        gen.seed(sessionSeed());
+        poseDist = std::uniform_int_distribution<>(0, (int)vocabulary.size() - 1);
+        state.back().poseEnd = poseEndAfter(beatMap, 0);
+        state.publish();
+    }
+
+    void onEnter() override {
+        if (danceMusic) {
+            Mix_PlayMusic(danceMusic, -1);
+            Mix_VolumeMusic(MIX_MAX_VOLUME / 2);
+            audioMusicStarted();
+        }
+    }
+
+    void onExit() override {
+        Mix_HaltMusic();
+        audioMusicStopped();
+        if (menuMusic) {
+            Mix_PlayMusic(menuMusic, -1);
+            Mix_VolumeMusic(MIX_MAX_VOLUME / 3);
+        }
+    }
+
+    void update(float dt, const GameInput& input) override {
+        RhythmDanceState& s = state.back();
+        // The session clock only starts moving once the game loop begins
+        // frames, so the song starts with the first tick.
+        if (startTime < 0) startTime = input.time;
+        double songTime = songClock(input, startTime);
+        s.particles.update(dt);
+        for (const SDL_Event& event : input.events) {
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_f) {
+                s.freestyle = !s.freestyle;
+                s.combo = 0;
+                s.pending.clear();
+                s.lastFreestylePose = -1;
+                s.freestyleBeat = beatMapNextBeat(beatMap, songTime);
+                s.poseStart = songTime;
+                s.poseEnd = poseEndAfter(beatMap, s.poseStart);
             }
         }
 
-        if (useCamera && cap.read(currentFrame)) {
-            cv::flip(currentFrame, currentFrame, 1);
-            poseDetector.detectBothHands(currentFrame);
+        if (input.pose.detected) {
+            // Once MAX_POSE_SAMPLES are kept, the oldest one makes way.
+            s.poseSamples.push_back({songTime, PoseFeature()});
+            poseFeatureFromKeypoints(input.pose.keypoints, true, s.poseSamples.back().feature);
+        }
+
+        poseFeatureFromKeypoints(input.pose.keypoints, true, s.livePose);
+
+        float similarity;
+        s.classified = vocabulary.classify(s.livePose, similarity);
+        s.recognised = s.classified >= 0 && similarity >= 0.5f;
+
+        // Freestyle: on every beat, a recognised pose different from the last
+        // one extends the combo; losing the pose breaks it.
+        while (s.freestyle && songTime >= s.freestyleBeat) {
+            if (s.recognised && s.classified != s.lastFreestylePose) {
+                s.combo++;
+                s.score += 10 * s.combo;
+                celebrateCombo(s);
+                s.lastFreestylePose = s.classified;
+            } else if (!s.recognised) {
+                s.combo = 0;
+                s.lastFreestylePose = -1;
+            }
+            s.freestyleBeat = beatMapNextBeat(beatMap, s.freestyleBeat + 0.01);
         }
 
-        poseTimer += 0.016f;
-        beatTimer += 0.016f;
-        
-        DancePose& targetPose = poses[currentPoseIdx];
-        
-        float leftDist = std::sqrt(
-            std::pow(poseDetector.leftHandX - targetPose.leftArmX, 2) +
-            std::pow(poseDetector.leftHandY - targetPose.leftArmY, 2)
-        );
-        float rightDist = std::sqrt(
-            std::pow(poseDetector.rightHandX - targetPose.rightArmX, 2) +
-            std::pow(poseDetector.rightHandY - targetPose.rightArmY, 2)
-        );
-        
-        bool poseMatched = (leftDist < 0.2f && rightDist < 0.2f);
-        
-        if (poseTimer > targetPose.duration) {
-            if (poseMatched) {
-                combo++;
-                score += 100 * combo;
+        while (!s.freestyle && songTime >= s.poseEnd) {
+            int nextPoseIdx = poseDist(gen);
+            s.pending.push_back({s.currentPoseIdx, nextPoseIdx, s.poseEnd});
+            s.currentPoseIdx = nextPoseIdx;
+            s.poseStart = s.poseEnd;
+            s.poseEnd = poseEndAfter(beatMap, s.poseStart);
+        }
+        while (!s.pending.empty() && songTime >= s.pending.front().end + JUDGE_LATE) {
+            float judged = judgePose(s.pending.front(), s.poseSamples, s.livePose, vocabulary);
+            if (judged >= 0.5f) {
+                s.combo++;
+                s.score += (int)(100 * judged) * s.combo;
+                celebrateCombo(s);
             } else {
-                combo = 0;
+                s.combo = 0;
             }
-            currentPoseIdx = poseDist(gen);
-            poseTimer = 0;
+            s.pending.pop_front();
         }
 
-        float beatPulse = std::sin(beatTimer * 4) * 0.5f + 0.5f;
+        const VocabularyPose& targetPose = vocabulary[s.currentPoseIdx];
+        s.poseMatched = s.freestyle ? s.recognised : poseSimilarity(poseDistance(
+            s.livePose, s.livePose.torsoRelative ? targetPose.torso : targetPose.image)) >= 0.5f;
+        s.songTime = songTime;
+    }
+
+    void render(SDL_Renderer* renderer) override {
+        const RhythmDanceState& s = state.front();
+        const VocabularyPose& targetPose = vocabulary[s.currentPoseIdx];
+        float poseTimer = (float)(s.songTime - s.poseStart);
+
+        float beatPulse = 1.0f - (float)beatMapPhase(beatMap, s.songTime);
+        beatPulse *= beatPulse;
 
         SDL_SetRenderDrawColor(renderer, (Uint8)(30 + beatPulse * 20), 20, (Uint8)(60 + beatPulse * 40), 255);
         SDL_Rect bg = {0, 0, GAME_WIDTH, GAME_HEIGHT};
         SDL_RenderFillRect(renderer, &bg);
 
-        SDL_SetRenderDrawColor(renderer, 100, 100, 100, 100);
-        int silhouetteX = GAME_WIDTH / 4;
-        int silhouetteY = GAME_HEIGHT / 2;
-        drawFilledCircle(renderer, silhouetteX, silhouetteY - 100, 40);
-        SDL_Rect body = {silhouetteX - 30, silhouetteY - 60, 60, 120};
-        SDL_RenderFillRect(renderer, &body);
-        
-        int leftTargetX = (int)(targetPose.leftArmX * GAME_WIDTH / 2);
-        int leftTargetY = (int)(targetPose.leftArmY * GAME_HEIGHT);
-        int rightTargetX = (int)(targetPose.rightArmX * GAME_WIDTH / 2);
-        int rightTargetY = (int)(targetPose.rightArmY * GAME_HEIGHT);
-        
-        SDL_SetRenderDrawColor(renderer, PINK.r, PINK.g, PINK.b, 200);
-        SDL_RenderDrawLine(renderer, silhouetteX, silhouetteY - 50, leftTargetX, leftTargetY);
-        SDL_RenderDrawLine(renderer, silhouetteX, silhouetteY - 50, rightTargetX, rightTargetY);
-        drawFilledCircle(renderer, leftTargetX, leftTargetY, 20);
-        drawFilledCircle(renderer, rightTargetX, rightTargetY, 20);
-
-        float progress = poseTimer / targetPose.duration;
-        SDL_SetRenderDrawColor(renderer, 50, 50, 50, 255);
-        SDL_Rect progressBg = {50, GAME_HEIGHT - 40, GAME_WIDTH - 100, 20};
-        SDL_RenderFillRect(renderer, &progressBg);
-        
-        if (poseMatched) {
-            SDL_SetRenderDrawColor(renderer, GREEN.r, GREEN.g, GREEN.b, 255);
+        if (s.freestyle) {
+            if (s.recognised) {
+                drawPoseFigure(renderer, vocabulary[s.classified].keypoints, GREEN);
+                SDL_SetRenderDrawColor(renderer, WHITE.r, WHITE.g, WHITE.b, WHITE.a);
+                drawText(renderer, vocabulary[s.classified].name.c_str(), 50, GAME_HEIGHT - 50, 16);
+            }
+            SDL_SetRenderDrawColor(renderer, PINK.r, PINK.g, PINK.b, 255);
+            drawText(renderer, "FREESTYLE", GAME_WIDTH - 200, 20, 16);
         } else {
-            SDL_SetRenderDrawColor(renderer, ORANGE.r, ORANGE.g, ORANGE.b, 255);
+            drawPoseFigure(renderer, targetPose.keypoints, PINK);
         }
-        SDL_Rect progressBar = {50, GAME_HEIGHT - 40, (int)((GAME_WIDTH - 100) * (1 - progress)), 20};
-        SDL_RenderFillRect(renderer, &progressBar);
+
+        if (!s.freestyle) {
+            float progress = poseTimer / (float)(s.poseEnd - s.poseStart);
+            SDL_SetRenderDrawColor(renderer, 50, 50, 50, 255);
+            SDL_Rect progressBg = {50, GAME_HEIGHT - 40, GAME_WIDTH - 100, 20};
+            SDL_RenderFillRect(renderer, &progressBg);
+
+            if (s.poseMatched) {
+                SDL_SetRenderDrawColor(renderer, GREEN.r, GREEN.g, GREEN.b, 255);
+            } else {
+                SDL_SetRenderDrawColor(renderer, ORANGE.r, ORANGE.g, ORANGE.b, 255);
+            }
+            SDL_Rect progressBar = {50, GAME_HEIGHT - 40, (int)((GAME_WIDTH - 100) * (1 - progress)), 20};
+            SDL_RenderFillRect(renderer, &progressBar);
+        }
+
+        s.particles.draw(renderer);
 
         SDL_SetRenderDrawColor(renderer, WHITE.r, WHITE.g, WHITE.b, WHITE.a);
-        drawNumber(renderer, score, 20, 20, 30);
-        
-        if (combo > 1) {
+        drawNumber(renderer, s.score, 20, 20, 30);
+
+        if (s.combo > 1) {
             SDL_SetRenderDrawColor(renderer, YELLOW.r, YELLOW.g, YELLOW.b, YELLOW.a);
-            drawNumber(renderer, combo, GAME_WIDTH/2 - 20, 20, 25);
+            drawNumber(renderer, s.combo, GAME_WIDTH/2 - 20, 20, 25);
         }
 
-        if (poseMatched) {
+        if (!s.freestyle) {
+            SDL_SetRenderDrawColor(renderer, WHITE.r, WHITE.g, WHITE.b, WHITE.a);
+            drawText(renderer, targetPose.name.c_str(), 50, GAME_HEIGHT - 70, 12);
+        }
+
+        if (s.poseMatched) {
             SDL_SetRenderDrawColor(renderer, GREEN.r, GREEN.g, GREEN.b, 255);
             SDL_Rect matchBox = {GAME_WIDTH/2 - 60, 80, 120, 40};
             SDL_RenderFillRect(renderer, &matchBox);
         }
-
-        drawCameraFeed(renderer, currentFrame, useCamera);
-        SDL_RenderPresent(renderer);
-        SDL_Delay(16);
-    }
-    
-    if (danceMusic) {
-        Mix_FreeMusic(danceMusic);
-    }
-    if (bgMusic) {
-        Mix_PlayMusic(bgMusic, -1);
-        Mix_VolumeMusic(MIX_MAX_VOLUME / 3);
     }
+
+    void publish() override { state.publish(); }
+
+private:
+    Mix_Music* menuMusic;
+    Mix_Music* danceMusic = nullptr;
+    BeatMap beatMap;
+    PoseVocabulary vocabulary;
+    std::mt19937 gen;
+    std::uniform_int_distribution<> poseDist;
+    double startTime = -1;   // session time of the first tick
+    DoubleBuffer<RhythmDanceState> state;
+};
+
+std::unique_ptr<Game> createRhythmDance(Mix_Music* menuMusic) {
+    return std::make_unique<RhythmDanceGame>(menuMusic);
 }
@@ -1,9 +1,8 @@
 #ifndef RHYTHM_DANCE_GAME_H
 #define RHYTHM_DANCE_GAME_H
 
-#include "common.h"
+#include "game.h"
 
-void runRhythmDance(SDL_Renderer* renderer, PoseDetector& poseDetector, cv::VideoCapture& cap,
-                    bool useCamera, cv::Mat& currentFrame, bool& returnToMenu, Mix_Music* bgMusic);
+std::unique_ptr<Game> createRhythmDance(Mix_Music* menuMusic);
 
 #endif
@@ -0,0 +1,590 @@
+#include "session.h"
+#include "capture_source.h"
+#include "trace.h"
+#include "perf_hud.h"
+#include "frame_prep.h"
+#include "idle_detector.h"
+#include "soak.h"
+#include "audio_engine.h"
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <cstdio>
+#include <cstring>
+
+static const char SESSION_MAGIC[4] = {'M', 'C', 'S', 'R'};
+static const Uint8 SESSION_VERSION = 2;   // 2 adds the music clock; 1 still replays
+static const int NUM_POSE_FIELDS = 5;
+
+static const SDL_Scancode TRACKED_KEYS[] = {
+    SDL_SCANCODE_W, SDL_SCANCODE_A, SDL_SCANCODE_S, SDL_SCANCODE_D,
+    SDL_SCANCODE_UP, SDL_SCANCODE_DOWN, SDL_SCANCODE_SPACE
+};
+static const int NUM_TRACKED_KEYS = sizeof(TRACKED_KEYS) / sizeof(TRACKED_KEYS[0]);
+
+enum SessionMode { SESSION_LIVE, SESSION_RECORD, SESSION_REPLAY };
+
+enum SessionEventKind {
+    SESSION_EVENT_QUIT,
+    SESSION_EVENT_KEYDOWN,
+    SESSION_EVENT_KEYUP,
+    SESSION_EVENT_MOUSEDOWN,
+    SESSION_EVENT_MOUSEUP
+};
+
+struct SessionFrame {
+    Uint32 ticks = 0;
+    bool hasFrame = false;
+    bool hasPose = false;
+    bool hasMusic = false;
+    float musicTime = 0;
+    int mouseX = 0, mouseY = 0;
+    Uint8 keyBits = 0;
+    std::vector<SDL_Event> events;
+    float pose[NUM_POSE_FIELDS] = {0};
+    std::vector<float> keypoints;
+};
+
+struct DeltaState {
+    Uint32 ticks = 0;
+    Uint32 musicTime = 0;
+    int mouseX = 0, mouseY = 0;
+    Uint32 pose[NUM_POSE_FIELDS] = {0};
+    std::vector<Uint32> keypoints;
+};
+
+static SessionMode mode = SESSION_LIVE;
+static SessionFrame current;
+static Uint32 captureTicks = 0;
+static DeltaState delta;
+static bool frameOpen = false;
+static int frameCount = 0;
+static std::string sessionPath;
+
+static std::mt19937 seedGen;
+static bool seedReady = false;
+static bool recordedCamera = false;
+
+static FILE* recordFile = nullptr;
+static std::thread writerThread;
+static std::mutex writerMutex;
+static std::condition_variable writerCv;
+static std::deque<std::vector<Uint8>> writeQueue;
+static bool writerStopping = false;
+
+static std::vector<Uint8> replayData;
+static size_t replayPos = 0;
+static size_t replayEventIdx = 0;
+static bool replayDone = false;
+static Uint8 replayKeys[SDL_NUM_SCANCODES];
+
+static void putByte(std::vector<Uint8>& out, Uint8 v) {
+    out.push_back(v);
+}
+
+static void putU32(std::vector<Uint8>& out, Uint32 v) {
+    for (int i = 0; i < 4; i++) out.push_back((Uint8)(v >> (8 * i)));
+}
+
+static void putVarint(std::vector<Uint8>& out, Uint32 v) {
+    while (v >= 0x80) {
+        out.push_back((Uint8)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((Uint8)v);
+}
+
+static Uint32 zigzag(Sint32 v) {
+    return ((Uint32)v << 1) ^ (Uint32)(v >> 31);
+}
+
+static Sint32 unzigzag(Uint32 v) {
+    return (Sint32)(v >> 1) ^ -(Sint32)(v & 1);
+}
+
+static Uint32 floatBits(float f) {
+    Uint32 bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+static float bitsFloat(Uint32 bits) {
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// Floats are stored as the zigzagged difference of their bit patterns, which
+// stays small while a value drifts slowly and round-trips exactly.
+static void putFloatDelta(std::vector<Uint8>& out, float value, Uint32& prev) {
+    Uint32 bits = floatBits(value);
+    putVarint(out, zigzag((Sint32)(bits - prev)));
+    prev = bits;
+}
+
+static bool getByte(Uint8& v) {
+    if (replayPos >= replayData.size()) return false;
+    v = replayData[replayPos++];
+    return true;
+}
+
+static bool getU32(Uint32& v) {
+    v = 0;
+    for (int i = 0; i < 4; i++) {
+        Uint8 b;
+        if (!getByte(b)) return false;
+        v |= (Uint32)b << (8 * i);
+    }
+    return true;
+}
+
+static bool getVarint(Uint32& v) {
+    v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        Uint8 b;
+        if (!getByte(b)) return false;
+        v |= (Uint32)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+static bool getSigned(Sint32& v) {
+    Uint32 u;
+    if (!getVarint(u)) return false;
+    v = unzigzag(u);
+    return true;
+}
+
+static bool getFloatDelta(float& value, Uint32& prev) {
+    Sint32 d;
+    if (!getSigned(d)) return false;
+    prev = prev + (Uint32)d;
+    value = bitsFloat(prev);
+    return true;
+}
+
+static void encodeFrame(const SessionFrame& f, std::vector<Uint8>& out) {
+    putVarint(out, f.ticks - delta.ticks);
+    delta.ticks = f.ticks;
+
+    putByte(out, (Uint8)((f.hasFrame ? 1 : 0) | (f.hasPose ? 2 : 0) | (f.hasMusic ? 4 : 0)));
+    if (f.hasMusic) putFloatDelta(out, f.musicTime, delta.musicTime);
+    putVarint(out, zigzag(f.mouseX - delta.mouseX));
+    putVarint(out, zigzag(f.mouseY - delta.mouseY));
+    delta.mouseX = f.mouseX;
+    delta.mouseY = f.mouseY;
+    putByte(out, f.keyBits);
+
+    putVarint(out, (Uint32)f.events.size());
+    for (const SDL_Event& e : f.events) {
+        switch (e.type) {
+            case SDL_QUIT:
+                putByte(out, SESSION_EVENT_QUIT);
+                break;
+            case SDL_KEYDOWN:
+            case SDL_KEYUP:
+                putByte(out, e.type == SDL_KEYDOWN ? SESSION_EVENT_KEYDOWN : SESSION_EVENT_KEYUP);
+                putVarint(out, zigzag(e.key.keysym.sym));
+                break;
+            default:
+                putByte(out, e.type == SDL_MOUSEBUTTONDOWN ? SESSION_EVENT_MOUSEDOWN : SESSION_EVENT_MOUSEUP);
+                putByte(out, e.button.button);
+                putVarint(out, zigzag(e.button.x));
+                putVarint(out, zigzag(e.button.y));
+                break;
+        }
+    }
+
+    if (f.hasPose) {
+        for (int i = 0; i < NUM_POSE_FIELDS; i++) {
+            putFloatDelta(out, f.pose[i], delta.pose[i]);
+        }
+        putVarint(out, (Uint32)f.keypoints.size());
+        if (delta.keypoints.size() < f.keypoints.size()) delta.keypoints.resize(f.keypoints.size(), 0);
+        for (size_t i = 0; i < f.keypoints.size(); i++) {
+            putFloatDelta(out, f.keypoints[i], delta.keypoints[i]);
+        }
+    }
+}
+
+static bool decodeFrame(SessionFrame& f) {
+    Uint32 dt;
+    if (!getVarint(dt)) return false;
+    delta.ticks += dt;
+    f.ticks = delta.ticks;
+
+    Uint8 flags;
+    Sint32 dx, dy;
+    if (!getByte(flags) || !getSigned(dx) || !getSigned(dy) || !getByte(f.keyBits)) return false;
+    f.hasFrame = (flags & 1) != 0;
+    f.hasPose = (flags & 2) != 0;
+    f.hasMusic = (flags & 4) != 0;
+    if (f.hasMusic && !getFloatDelta(f.musicTime, delta.musicTime)) return false;
+    delta.mouseX += dx;
+    delta.mouseY += dy;
+    f.mouseX = delta.mouseX;
+    f.mouseY = delta.mouseY;
+
+    Uint32 numEvents;
+    if (!getVarint(numEvents)) return false;
+    f.events.clear();
+    for (Uint32 i = 0; i < numEvents; i++) {
+        Uint8 kind;
+        if (!getByte(kind)) return false;
+        SDL_Event e;
+        std::memset(&e, 0, sizeof(e));
+        if (kind == SESSION_EVENT_QUIT) {
+            e.type = SDL_QUIT;
+        } else if (kind == SESSION_EVENT_KEYDOWN || kind == SESSION_EVENT_KEYUP) {
+            Sint32 sym;
+            if (!getSigned(sym)) return false;
+            e.type = kind == SESSION_EVENT_KEYDOWN ? SDL_KEYDOWN : SDL_KEYUP;
+            e.key.state = kind == SESSION_EVENT_KEYDOWN ? SDL_PRESSED : SDL_RELEASED;
+            e.key.keysym.sym = sym;
+        } else {
+            Uint8 button;
+            Sint32 x, y;
+            if (!getByte(button) || !getSigned(x) || !getSigned(y)) return false;
+            e.type = kind == SESSION_EVENT_MOUSEDOWN ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+            e.button.button = button;
+            e.button.x = x;
+            e.button.y = y;
+        }
+        f.events.push_back(e);
+    }
+
+    if (f.hasPose) {
+        for (int i = 0; i < NUM_POSE_FIELDS; i++) {
+            if (!getFloatDelta(f.pose[i], delta.pose[i])) return false;
+        }
+        Uint32 numKeypoints;
+        if (!getVarint(numKeypoints) || numKeypoints > replayData.size()) return false;
+        f.keypoints.resize(numKeypoints);
+        if (delta.keypoints.size() < numKeypoints) delta.keypoints.resize(numKeypoints, 0);
+        for (Uint32 i = 0; i < numKeypoints; i++) {
+            if (!getFloatDelta(f.keypoints[i], delta.keypoints[i])) return false;
+        }
+    }
+    return true;
+}
+
+static void writerLoop() {
+    traceSetThreadName("session-writer");
+    std::unique_lock<std::mutex> lock(writerMutex);
+    while (true) {
+        writerCv.wait(lock, [] { return writerStopping || !writeQueue.empty(); });
+        while (!writeQueue.empty()) {
+            std::vector<Uint8> chunk = std::move(writeQueue.front());
+            writeQueue.pop_front();
+            lock.unlock();
+            fwrite(chunk.data(), 1, chunk.size(), recordFile);
+            lock.lock();
+        }
+        if (writerStopping) break;
+    }
+}
+
+static void queueWrite(std::vector<Uint8>&& chunk) {
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        writeQueue.push_back(std::move(chunk));
+    }
+    writerCv.notify_one();
+}
+
+static void flushCurrentFrame() {
+    if (!frameOpen) return;
+    std::vector<Uint8> chunk;
+    chunk.reserve(64);
+    encodeFrame(current, chunk);
+    queueWrite(std::move(chunk));
+    frameCount++;
+    frameOpen = false;
+}
+
+bool sessionStartRecording(const std::string& path, bool useCamera) {
+    recordFile = fopen(path.c_str(), "wb");
+    if (!recordFile) {
+        std::cerr << "Could not open session file for writing: " << path << std::endl;
+        return false;
+    }
+
+    std::random_device rd;
+    Uint32 seed = rd();
+    seedGen.seed(seed);
+    seedReady = true;
+    recordedCamera = useCamera;
+
+    std::vector<Uint8> header(SESSION_MAGIC, SESSION_MAGIC + 4);
+    putByte(header, SESSION_VERSION);
+    putU32(header, seed);
+    putByte(header, useCamera ? 1 : 0);
+
+    delta = DeltaState();
+    current = SessionFrame();
+    frameOpen = false;
+    frameCount = 0;
+    writerStopping = false;
+    sessionPath = path;
+    mode = SESSION_RECORD;
+
+    queueWrite(std::move(header));
+    writerThread = std::thread(writerLoop);
+    std::cout << "Recording session to " << path << std::endl;
+    return true;
+}
+
+bool sessionStartReplay(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.good()) {
+        std::cerr << "Could not open session file: " << path << std::endl;
+        return false;
+    }
+    replayData.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    replayPos = 0;
+
+    Uint8 version, camera;
+    Uint32 seed;
+    if (replayData.size() < 4 || std::memcmp(replayData.data(), SESSION_MAGIC, 4) != 0) {
+        std::cerr << "Not a session recording: " << path << std::endl;
+        return false;
+    }
+    replayPos = 4;
+    if (!getByte(version) || version < 1 || version > SESSION_VERSION || !getU32(seed) || !getByte(camera)) {
+        std::cerr << "Unsupported session recording: " << path << std::endl;
+        return false;
+    }
+
+    seedGen.seed(seed);
+    seedReady = true;
+    recordedCamera = camera != 0;
+
+    delta = DeltaState();
+    current = SessionFrame();
+    replayDone = false;
+    frameCount = 0;
+    sessionPath = path;
+    mode = SESSION_REPLAY;
+    std::cout << "Replaying session from " << path << std::endl;
+    return true;
+}
+
+void sessionStop() {
+    if (mode == SESSION_RECORD) {
+        flushCurrentFrame();
+        {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            writerStopping = true;
+        }
+        writerCv.notify_one();
+        writerThread.join();
+        fclose(recordFile);
+        recordFile = nullptr;
+        std::cout << "Session recorded: " << frameCount << " frames to " << sessionPath << std::endl;
+    } else if (mode == SESSION_REPLAY) {
+        replayData.clear();
+        std::cout << "Session replayed: " << frameCount << " frames from " << sessionPath << std::endl;
+    }
+    mode = SESSION_LIVE;
+}
+
+bool sessionRecording() {
+    return mode == SESSION_RECORD;
+}
+
+bool sessionReplaying() {
+    return mode == SESSION_REPLAY;
+}
+
+bool sessionRecordedCamera() {
+    return recordedCamera;
+}
+
+void sessionBeginFrame() {
+    if (mode == SESSION_REPLAY) {
+        replayEventIdx = 0;
+        if (replayDone) return;
+        if (!decodeFrame(current)) {
+            replayDone = true;
+            return;
+        }
+        frameCount++;
+        std::memset(replayKeys, 0, sizeof(replayKeys));
+        for (int i = 0; i < NUM_TRACKED_KEYS; i++) {
+            if (current.keyBits & (1 << i)) replayKeys[TRACKED_KEYS[i]] = 1;
+        }
+        return;
+    }
+
+    if (mode == SESSION_RECORD) {
+        flushCurrentFrame();
+        current.events.clear();
+        current.hasFrame = false;
+        current.hasPose = false;
+        frameOpen = true;
+    }
+    current.ticks = soakActive() ? soakTicks() : SDL_GetTicks();
+    // Soak runs outpace the mixer, so they stay on session time.
+    double music = soakActive() ? -1 : audioMusicTime();
+    current.hasMusic = music >= 0;
+    current.musicTime = (float)music;
+}
+
+Uint32 sessionTicks() {
+    return current.ticks;
+}
+
+double sessionMusicTime() {
+    return current.hasMusic ? current.musicTime : -1;
+}
+
+Uint32 sessionCaptureTicks() {
+    return captureTicks;
+}
+
+Uint32 sessionSeed() {
+    if (!seedReady) {
+        std::random_device rd;
+        seedGen.seed(rd());
+        seedReady = true;
+    }
+    return seedGen();
+}
+
+bool sessionPollEvent(SDL_Event* event) {
+    if (mode == SESSION_REPLAY) {
+        SDL_Event live;
+        while (SDL_PollEvent(&live)) {
+            perfHudHandleEvent(live);
+            if (live.type == SDL_QUIT) {
+                *event = live;
+                return true;
+            }
+        }
+        if (replayDone) {
+            if (replayEventIdx > 0) return false;
+            replayEventIdx = 1;
+            std::memset(event, 0, sizeof(*event));
+            event->type = SDL_QUIT;
+            return true;
+        }
+        if (replayEventIdx >= current.events.size()) return false;
+        *event = current.events[replayEventIdx++];
+        return true;
+    }
+
+    if (!SDL_PollEvent(event)) return false;
+    perfHudHandleEvent(*event);
+    if (mode == SESSION_RECORD) {
+        switch (event->type) {
+            case SDL_QUIT:
+            case SDL_KEYDOWN:
+            case SDL_KEYUP:
+            case SDL_MOUSEBUTTONDOWN:
+            case SDL_MOUSEBUTTONUP:
+                current.events.push_back(*event);
+                break;
+        }
+    }
+    return true;
+}
+
+const Uint8* sessionKeyboardState() {
+    if (mode == SESSION_REPLAY) return replayKeys;
+
+    const Uint8* keys = SDL_GetKeyboardState(NULL);
+    if (mode == SESSION_RECORD) {
+        current.keyBits = 0;
+        for (int i = 0; i < NUM_TRACKED_KEYS; i++) {
+            if (keys[TRACKED_KEYS[i]]) current.keyBits |= (Uint8)(1 << i);
+        }
+    }
+    return keys;
+}
+
+Uint32 sessionMouseState(int* x, int* y) {
+    if (mode == SESSION_REPLAY) {
+        if (x) *x = current.mouseX;
+        if (y) *y = current.mouseY;
+        return 0;
+    }
+
+    int mx, my;
+    Uint32 buttons = SDL_GetMouseState(&mx, &my);
+    if (mode == SESSION_RECORD) {
+        current.mouseX = mx;
+        current.mouseY = my;
+    }
+    if (x) *x = mx;
+    if (y) *y = my;
+    return buttons;
+}
+
+bool sessionCaptureFrame(CaptureSource& cap, cv::Mat& frame) {
+    captureTicks = current.ticks;
+    if (mode == SESSION_REPLAY) {
+        return !replayDone && current.hasFrame;
+    }
+
+    double now = sessionTicks() / 1000.0;
+    bool ok = false;
+    if (idleShouldCapture(now)) {
+        TRACE_SCOPE("capture");
+        ok = cap.read(frame);
+    }
+    if (ok && !soakActive()) {
+        double ageMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                                 cap.frameCaptureTime()).count();
+        Uint32 wallTicks = SDL_GetTicks();
+        captureTicks = wallTicks - (Uint32)std::max(0.0, std::min((double)wallTicks, ageMs));
+    }
+    if (ok) {
+        perfHudCameraFrame();
+        TRACE_SCOPE("prepare");
+        framePrepare(frame);
+        idleObserveFrame(frame, now);
+    }
+    if (mode == SESSION_RECORD) {
+        current.hasFrame = ok;
+    }
+    return ok;
+}
+
+void sessionLogPose(const PoseDetector& pose) {
+    if (mode != SESSION_RECORD) return;
+    current.hasPose = true;
+    current.pose[0] = pose.armCenterY;
+    current.pose[1] = pose.leftHandX;
+    current.pose[2] = pose.leftHandY;
+    current.pose[3] = pose.rightHandX;
+    current.pose[4] = pose.rightHandY;
+    current.keypoints.clear();
+    for (const Keypoint& k : pose.keypoints) {
+        current.keypoints.push_back(k.x);
+        current.keypoints.push_back(k.y);
+        current.keypoints.push_back(k.confidence);
+    }
+}
+
+bool sessionApplyPose(PoseDetector& pose) {
+    if (mode != SESSION_REPLAY) return false;
+    if (current.hasPose) {
+        pose.armCenterY = current.pose[0];
+        pose.leftHandX = current.pose[1];
+        pose.leftHandY = current.pose[2];
+        pose.rightHandX = current.pose[3];
+        pose.rightHandY = current.pose[4];
+        if (current.keypoints.size() == NUM_KEYPOINTS * 3) {
+            for (int i = 0; i < NUM_KEYPOINTS; i++) {
+                pose.keypoints[i] = {current.keypoints[i * 3], current.keypoints[i * 3 + 1],
+                                     current.keypoints[i * 3 + 2]};
+            }
+        } else {
+            pose.keypointsFromHands();
+        }
+    }
+    return true;
+}
@@ -0,0 +1,45 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "common.h"
+#include <string>
+
+class CaptureSource;
+
+// Session recording and replay.
+//
+// Every game loop iteration is one frame. While recording, the frame timestamp,
+// the music clock, input events, keyboard/mouse state, whether a camera frame
+// was read and the PoseDetector outputs are delta-encoded and handed to a
+// writer thread. While
+// replaying, the same calls return the recorded values instead of touching SDL,
+// the camera or the model, so a session re-simulates bit-exactly.
+
+bool sessionStartRecording(const std::string& path, bool useCamera);
+bool sessionStartReplay(const std::string& path);
+void sessionStop();
+
+bool sessionRecording();
+bool sessionReplaying();
+bool sessionRecordedCamera();
+
+void sessionBeginFrame();
+Uint32 sessionTicks();
+// Song position from audioMusicTime() at the start of the frame, or -1 with
+// no music playing. Recorded with the frame, so replays see the same clock.
+double sessionMusicTime();
+Uint32 sessionSeed();
+
+bool sessionPollEvent(SDL_Event* event);
+const Uint8* sessionKeyboardState();
+Uint32 sessionMouseState(int* x, int* y);
+
+bool sessionCaptureFrame(CaptureSource& cap, cv::Mat& frame);
+// Session time at which the last frame read was captured. Live frames are
+// dated back by their age from CaptureSource::frameCaptureTime(); scripted
+// and replayed frames carry the frame's own time.
+Uint32 sessionCaptureTicks();
+void sessionLogPose(const PoseDetector& pose);
+bool sessionApplyPose(PoseDetector& pose);
+
+#endif
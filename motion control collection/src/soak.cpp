@@ -0,0 +1,419 @@
+#include "soak.h"
+#include "capture_source.h"
+#include "session.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <new>
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+typedef std::chrono::steady_clock SoakClock;
+
+// Every operator new and delete in the program is counted, so a report can
+// tell allocation churn and a growing number of live blocks apart.
+static std::atomic<long> heapAllocations(0);
+static std::atomic<long> heapFrees(0);
+
+void* operator new(std::size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return operator new(size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    heapFrees.fetch_add(1, std::memory_order_relaxed);
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    operator delete(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    operator delete(p);
+}
+
+static const double HISTOGRAM_BIN_MS = 0.02;
+static const int HISTOGRAM_BINS = 5000;        // up to 100 ms; slower frames share the last bin
+static const int SCRIPT_WIDTH = 640;
+static const int SCRIPT_HEIGHT = 480;
+static const double SCRIPT_PERIOD = 8.0;
+static const float SCRIPT_CONFIDENCE = 0.9f;
+
+struct ScriptKey {
+    SDL_Keycode key;
+    double every;
+};
+
+// SPACE starts pickleball rallies and fires arrows, F switches the dance to
+// freestyle, M switches boxing to the swarm and R resets pickleball.
+static const ScriptKey SCRIPT_KEYS[] = {
+    {SDLK_SPACE, 3.0}, {SDLK_f, 45.0}, {SDLK_m, 60.0}, {SDLK_r, 120.0},
+};
+
+// Fixed-size histogram, so recording a frame never allocates.
+struct FrameTimes {
+    std::vector<long> bins;
+    long frames = 0;
+    double maxMs = 0;
+
+    void clear() {
+        bins.assign(HISTOGRAM_BINS, 0);
+        frames = 0;
+        maxMs = 0;
+    }
+
+    void add(double ms) {
+        bins[std::min(HISTOGRAM_BINS - 1, (int)(ms / HISTOGRAM_BIN_MS))]++;
+        frames++;
+        maxMs = std::max(maxMs, ms);
+    }
+
+    double percentile(double p) const {
+        long target = (long)std::ceil(p * frames);
+        long seen = 0;
+        for (int i = 0; i < HISTOGRAM_BINS - 1; i++) {
+            seen += bins[i];
+            if (seen >= target) return std::min(maxMs, (i + 1) * HISTOGRAM_BIN_MS);
+        }
+        return maxMs;
+    }
+};
+
+struct Memory {
+    bool rssKnown = false;   // only read on Linux and macOS
+    double rssMb = 0;
+    double peakMb = 0;
+    long allocations = 0;
+    long live = 0;
+};
+
+static bool active = false;
+static SoakOptions options;
+static Uint32 simulatedTicks = 0;
+static double lastKeyTime = 0;
+static SoakClock::time_point runStart;
+
+static const char* visitName = "";
+static int visits = 0;
+static FrameTimes visitTimes;
+static FrameTimes allTimes;
+static SoakClock::time_point visitStart;
+static SoakClock::time_point frameStart;
+static Uint32 visitStartTicks = 0;
+static long visitStartAllocations = 0;
+static Memory firstMemory;
+static Memory lastMemory;
+
+static Memory readMemory() {
+    Memory memory;
+#if defined(__linux__)
+    // statm counts pages; ru_maxrss is in kilobytes here.
+    long pages = 0, resident = 0;
+    FILE* statm = std::fopen("/proc/self/statm", "r");
+    if (statm) {
+        if (std::fscanf(statm, "%ld %ld", &pages, &resident) == 2) {
+            memory.rssMb = resident * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+            memory.rssKnown = true;
+        }
+        std::fclose(statm);
+    }
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) memory.peakMb = usage.ru_maxrss / 1024.0;
+#elif defined(__APPLE__)
+    // No /proc, and ru_maxrss is in bytes, so ask the kernel for both.
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS) {
+        memory.rssMb = info.resident_size / (1024.0 * 1024.0);
+        memory.peakMb = info.resident_size_max / (1024.0 * 1024.0);
+        memory.rssKnown = true;
+    }
+#endif
+    memory.allocations = heapAllocations.load(std::memory_order_relaxed);
+    memory.live = memory.allocations - heapFrees.load(std::memory_order_relaxed);
+    return memory;
+}
+
+static double secondsSince(SoakClock::time_point start) {
+    return std::chrono::duration<double>(SoakClock::now() - start).count();
+}
+
+bool soakParseDuration(const std::string& text, double& seconds) {
+    char* end = nullptr;
+    double value = std::strtod(text.c_str(), &end);
+    if (end == text.c_str() || value < 0) return false;
+    std::string unit(end);
+    if (unit.empty() || unit == "s") {
+        seconds = value;
+    } else if (unit == "m") {
+        seconds = value * 60.0;
+    } else if (unit == "h") {
+        seconds = value * 3600.0;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void soakStart(const SoakOptions& soakOptions) {
+    options = soakOptions;
+    active = true;
+    simulatedTicks = 0;
+    lastKeyTime = 0;
+    visits = 0;
+    visitTimes.clear();
+    allTimes.clear();
+    runStart = SoakClock::now();
+    std::cout << "Soak run: " << (options.scripted ? "scripted player" : "replayed session")
+              << (options.present ? "" : ", not presenting");
+    if (options.scripted) std::cout << ", " << options.gameSeconds << " simulated s per game";
+    if (options.wallSeconds > 0) std::cout << ", stopping after " << options.wallSeconds << " s";
+    std::cout << std::endl;
+}
+
+bool soakActive() {
+    return active;
+}
+
+bool soakScripted() {
+    return active && options.scripted;
+}
+
+bool soakPresents() {
+    return !active || options.present;
+}
+
+Uint32 soakTicks() {
+    return simulatedTicks;
+}
+
+static float clamp01(double t) {
+    return (float)std::max(0.0, std::min(1.0, t));
+}
+
+// Wrist positions of the synthetic player at script time t. POSE_LEFT_* is
+// on the left of the screen (see BodyPart).
+static void scriptWrists(double t, float leftX, float rightX, float shoulderY, Keypoint& left, Keypoint& right) {
+    double phase = std::fmod(t, SCRIPT_PERIOD);
+    if (phase < 2.0) {
+        // Reaching up and down, arms in opposition.
+        float s = (float)std::sin(phase * 3.14159265);
+        left = {leftX - 0.1f, shoulderY + 0.2f - 0.4f * s, SCRIPT_CONFIDENCE};
+        right = {rightX + 0.1f, shoulderY - 0.2f + 0.4f * s, SCRIPT_CONFIDENCE};
+    } else if (phase < 4.0) {
+        // Alternating punches from a guard: out in 80 ms, back in 250 ms.
+        double p = std::fmod(phase - 2.0, 0.5);
+        float reach = p < 0.08 ? clamp01(p / 0.08) : 1.0f - clamp01((p - 0.08) / 0.25);
+        bool leftPunch = (int)((phase - 2.0) / 0.5) % 2 == 0;
+        left = {leftX + 0.03f, shoulderY + 0.1f, SCRIPT_CONFIDENCE};
+        right = {rightX - 0.03f, shoulderY + 0.1f, SCRIPT_CONFIDENCE};
+        Keypoint& fist = leftPunch ? left : right;
+        fist.x += (leftPunch ? 0.12f : -0.12f) * reach;
+        fist.y -= 0.1f * reach;
+    } else if (phase < 6.0) {
+        // A forehand: low right to high left in 300 ms, then back down.
+        double p = phase - 4.0;
+        float swing = p < 1.0 ? clamp01((p - 0.5) / 0.3) : 1.0f - clamp01((p - 1.0) / 0.8);
+        left = {leftX - 0.05f, shoulderY + 0.25f, SCRIPT_CONFIDENCE};
+        right = {rightX + 0.15f - 0.45f * swing, shoulderY + 0.3f - 0.35f * swing, SCRIPT_CONFIDENCE};
+    } else {
+        // Drawing a bow over 1.2 s, holding, and letting go.
+        double p = phase - 6.0;
+        float draw = clamp01(p / 1.2);
+        float release = clamp01((p - 1.6) / 0.06);
+        left = {leftX - 0.25f, shoulderY, SCRIPT_CONFIDENCE};
+        right = {leftX - 0.2f + (rightX - leftX + 0.25f) * draw + 0.1f * release, shoulderY, SCRIPT_CONFIDENCE};
+    }
+}
+
+static void scriptKeypoints(double t, Keypoint* keypoints) {
+    float cx = 0.5f + 0.15f * (float)std::sin(t * 2.0 * 3.14159265 / 11.0);
+    float sy = 0.35f;
+    auto set = [&](int part, float x, float y) { keypoints[part] = {x, y, SCRIPT_CONFIDENCE}; };
+    set(POSE_NOSE, cx, sy - 0.12f);
+    set(POSE_LEFT_EYE, cx - 0.02f, sy - 0.14f);
+    set(POSE_RIGHT_EYE, cx + 0.02f, sy - 0.14f);
+    set(POSE_LEFT_EAR, cx - 0.04f, sy - 0.13f);
+    set(POSE_RIGHT_EAR, cx + 0.04f, sy - 0.13f);
+    set(POSE_NECK, cx, sy);
+    set(POSE_LEFT_SHOULDER, cx - 0.08f, sy);
+    set(POSE_RIGHT_SHOULDER, cx + 0.08f, sy);
+    set(POSE_LEFT_HIP, cx - 0.05f, sy + 0.3f);
+    set(POSE_RIGHT_HIP, cx + 0.05f, sy + 0.3f);
+    set(POSE_LEFT_KNEE, cx - 0.05f, sy + 0.45f);
+    set(POSE_RIGHT_KNEE, cx + 0.05f, sy + 0.45f);
+    set(POSE_LEFT_ANKLE, cx - 0.05f, sy + 0.6f);
+    set(POSE_RIGHT_ANKLE, cx + 0.05f, sy + 0.6f);
+    scriptWrists(t, cx - 0.08f, cx + 0.08f, sy, keypoints[POSE_LEFT_WRIST], keypoints[POSE_RIGHT_WRIST]);
+    const Keypoint& ls = keypoints[POSE_LEFT_SHOULDER];
+    const Keypoint& rs = keypoints[POSE_RIGHT_SHOULDER];
+    const Keypoint& lw = keypoints[POSE_LEFT_WRIST];
+    const Keypoint& rw = keypoints[POSE_RIGHT_WRIST];
+    set(POSE_LEFT_ELBOW, (ls.x + lw.x) / 2, (ls.y + lw.y) / 2 + 0.03f);
+    set(POSE_RIGHT_ELBOW, (rs.x + rw.x) / 2, (rs.y + rw.y) / 2 + 0.03f);
+}
+
+// The preview shows the script's keypoints; frames are unmirrored like a
+// camera's.
+static bool scriptFrame(long, cv::Mat& frame) {
+    Keypoint keypoints[NUM_KEYPOINTS];
+    scriptKeypoints(sessionTicks() / 1000.0, keypoints);
+    frame.create(SCRIPT_HEIGHT, SCRIPT_WIDTH, CV_8UC3);
+    frame.setTo(cv::Scalar(40, 40, 40));
+    for (int i = 0; i < NUM_KEYPOINTS; i++) {
+        cv::Point p((int)((1.0f - keypoints[i].x) * SCRIPT_WIDTH), (int)(keypoints[i].y * SCRIPT_HEIGHT));
+        cv::circle(frame, p, 8, cv::Scalar(220, 220, 220), cv::FILLED);
+    }
+    return true;
+}
+
+bool soakOpenScript(CaptureSource& cap) {
+    return cap.openGenerator("scripted player", scriptFrame, 1000.0 / SOAK_FRAME_MS, false);
+}
+
+bool soakApplyPose(PoseDetector& pose) {
+    if (!soakScripted()) return false;
+    scriptKeypoints(sessionTicks() / 1000.0, pose.keypoints);
+    const Keypoint& leftWrist = pose.keypoints[POSE_LEFT_WRIST];
+    const Keypoint& rightWrist = pose.keypoints[POSE_RIGHT_WRIST];
+    pose.leftHandX = leftWrist.x;
+    pose.leftHandY = leftWrist.y;
+    pose.rightHandX = rightWrist.x;
+    pose.rightHandY = rightWrist.y;
+    pose.armCenterY = pose.armCenterY * 0.7f + (0.5f + leftWrist.y + rightWrist.y) / 3 * 0.3f;
+    return true;
+}
+
+void soakPushEvents() {
+    double now = sessionTicks() / 1000.0;
+    for (const ScriptKey& key : SCRIPT_KEYS) {
+        if (std::floor(now / key.every) == std::floor(lastKeyTime / key.every)) continue;
+        SDL_Event event;
+        std::memset(&event, 0, sizeof(event));
+        event.type = SDL_KEYDOWN;
+        event.key.keysym.sym = key.key;
+        SDL_PushEvent(&event);
+    }
+    lastKeyTime = now;
+}
+
+void soakBeginGame(const char* name) {
+    visitName = name;
+    visitTimes.clear();
+    visitStartTicks = simulatedTicks;
+    visitStartAllocations = heapAllocations.load(std::memory_order_relaxed);
+    visitStart = SoakClock::now();
+    frameStart = visitStart;
+}
+
+bool soakFrameDone() {
+    SoakClock::time_point now = SoakClock::now();
+    double ms = std::chrono::duration<double, std::milli>(now - frameStart).count();
+    frameStart = now;
+    visitTimes.add(ms);
+    allTimes.add(ms);
+    simulatedTicks += SOAK_FRAME_MS;
+
+    if (options.wallSeconds > 0 && std::chrono::duration<double>(now - runStart).count() >= options.wallSeconds) {
+        return false;
+    }
+    return !options.scripted || (simulatedTicks - visitStartTicks) < options.gameSeconds * 1000.0;
+}
+
+void soakEndGame() {
+    if (visitTimes.frames == 0) return;
+    Memory memory = readMemory();
+    if (visits == 0) firstMemory = memory;
+    lastMemory = memory;
+    visits++;
+
+    double wall = secondsSince(visitStart);
+    double simulated = visitTimes.frames * SOAK_FRAME_MS / 1000.0;
+    long allocations = memory.allocations - visitStartAllocations;
+    double p50 = visitTimes.percentile(0.5), p95 = visitTimes.percentile(0.95), p99 = visitTimes.percentile(0.99);
+
+    std::cout << std::fixed << std::setprecision(1) << "Soak " << visits << " " << visitName << ": "
+              << visitTimes.frames << " frames, " << simulated << " s simulated in " << wall << " s ("
+              << (wall > 0 ? simulated / wall : 0) << "x), frame p50 " << std::setprecision(2) << p50 << " p95 "
+              << p95 << " p99 " << p99 << " max " << visitTimes.maxMs << " ms, RSS ";
+    if (memory.rssKnown) {
+        std::cout << std::setprecision(1) << memory.rssMb << " MB (" << std::showpos
+                  << memory.rssMb - firstMemory.rssMb << std::noshowpos << ")";
+    } else {
+        std::cout << "n/a";
+    }
+    std::cout << ", " << allocations << " allocations, " << memory.live << " live (" << std::showpos
+              << memory.live - firstMemory.live << std::noshowpos << ")" << std::defaultfloat << std::endl;
+
+    if (options.outPath.empty()) return;
+    std::ofstream out(options.outPath, std::ios::app);
+    if (!out) {
+        std::cerr << "Could not write soak results to " << options.outPath << std::endl;
+        return;
+    }
+    out << "{\"visit\":" << visits << ",\"game\":\"" << visitName << "\",\"frames\":" << visitTimes.frames
+        << ",\"simulated_s\":" << simulated << ",\"wall_s\":" << wall << ",\"p50_ms\":" << p50
+        << ",\"p95_ms\":" << p95 << ",\"p99_ms\":" << p99 << ",\"max_ms\":" << visitTimes.maxMs
+        << ",\"rss_mb\":";
+    if (memory.rssKnown) out << memory.rssMb << ",\"peak_rss_mb\":" << memory.peakMb;
+    else out << "null,\"peak_rss_mb\":null";
+    out << ",\"allocations\":" << allocations << ",\"live_allocations\":" << memory.live << "}\n";
+}
+
+bool soakFinished() {
+    return active && options.wallSeconds > 0 && secondsSince(runStart) >= options.wallSeconds;
+}
+
+void soakPrintSummary() {
+    if (!active || allTimes.frames == 0) return;
+    double wall = secondsSince(runStart);
+    double simulated = allTimes.frames * SOAK_FRAME_MS / 1000.0;
+    std::cout << std::fixed << std::setprecision(1) << "Soak total: " << visits << " visits, " << allTimes.frames
+              << " frames, " << simulated / 3600.0 << " h simulated in " << wall / 3600.0 << " h ("
+              << (wall > 0 ? simulated / wall : 0) << "x), frame p50 " << std::setprecision(2)
+              << allTimes.percentile(0.5) << " p95 " << allTimes.percentile(0.95) << " p99 "
+              << allTimes.percentile(0.99) << " max " << allTimes.maxMs << " ms" << std::endl;
+    if (visits > 0) {
+        std::cout << std::setprecision(1) << "Soak memory: RSS ";
+        if (lastMemory.rssKnown) {
+            std::cout << firstMemory.rssMb << " -> " << lastMemory.rssMb << " MB (peak " << lastMemory.peakMb << ")";
+        } else {
+            std::cout << "n/a";
+        }
+        std::cout << ", live allocations " << firstMemory.live << " -> "
+                  << lastMemory.live << " over " << visits << " visits" << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
@@ -0,0 +1,59 @@
+#ifndef SOAK_H
+#define SOAK_H
+
+#include "common.h"
+#include <string>
+
+class CaptureSource;
+
+// Faster-than-real-time runs for soak and regression testing. The game loop
+// stops sleeping (and optionally presenting), and session time advances by
+// one game tick per frame instead of following the wall clock, so games see
+// the same time steps they would live. Pose input is either a replayed
+// session or a built-in script: a synthetic player who keeps reaching,
+// punching, swinging and drawing a bow, with SPACE, R and F pressed now and
+// then. In scripted runs every game is played in turn for a fixed stretch
+// of simulated time until the wall-clock budget is spent.
+//
+// After each stretch a report line gives frame-time percentiles, resident
+// memory and heap allocation counts (operator new, so OpenCV's own buffers
+// only show up in the RSS).
+const double SOAK_GAME_SECONDS = 600.0;     // simulated time per game visit
+const Uint32 SOAK_FRAME_MS = 16;            // one game tick
+
+struct SoakOptions {
+    double wallSeconds = 0;                 // 0: run until the input ends or the window closes
+    double gameSeconds = SOAK_GAME_SECONDS;
+    bool present = true;
+    bool scripted = true;
+    std::string outPath;                    // report lines are appended here as JSON
+};
+
+// Parses a duration such as 90, 90s, 45m or 8h into seconds.
+bool soakParseDuration(const std::string& text, double& seconds);
+
+void soakStart(const SoakOptions& options);
+bool soakActive();
+bool soakScripted();
+bool soakPresents();
+
+// Simulated session time in milliseconds.
+Uint32 soakTicks();
+
+// Scripted input: a generator for the camera preview, the keypoints of the
+// synthetic player and the key presses that start rallies, fire arrows and
+// switch modes.
+bool soakOpenScript(CaptureSource& cap);
+bool soakApplyPose(PoseDetector& pose);
+void soakPushEvents();
+
+// One game visit. soakFrameDone() records the frame time, advances the
+// simulated clock and returns false once the visit has used up its time.
+void soakBeginGame(const char* name);
+bool soakFrameDone();
+void soakEndGame();
+bool soakFinished();
+
+void soakPrintSummary();
+
+#endif
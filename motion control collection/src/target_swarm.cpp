@@ -0,0 +1,186 @@
+#include "target_swarm.h"
+
+TargetSwarm::TargetSwarm() {
+    x.resize(MAX_TARGETS);
+    y.resize(MAX_TARGETS);
+    vx.resize(MAX_TARGETS);
+    vy.resize(MAX_TARGETS);
+    radius.resize(MAX_TARGETS);
+    lifetime.resize(MAX_TARGETS);
+    colorIdx.resize(MAX_TARGETS);
+    alive.resize(MAX_TARGETS);
+    cellOf.resize(MAX_TARGETS);
+    cellStart.resize(GRID_COLS * GRID_ROWS + 1);
+    cellCursor.resize(GRID_COLS * GRID_ROWS);
+    sortedIdx.resize(MAX_TARGETS);
+    sortedX.resize(MAX_TARGETS);
+    sortedY.resize(MAX_TARGETS);
+    sortedR2.resize(MAX_TARGETS);
+    hitMask.resize(MAX_TARGETS);
+    spans.reserve(MAX_TARGETS * MAX_RADIUS * 2);
+
+    for (int r = 0; r <= MAX_RADIUS; r++) {
+        for (int row = 0; row < MAX_RADIUS * 2; row++) {
+            float dy = row - r + 0.5f;
+            float h2 = (float)(r * r) - dy * dy;
+            halfWidth[r][row] = (row < r * 2 && h2 > 0) ? (int)std::sqrt(h2) : 0;
+        }
+    }
+}
+
+TargetSwarm& TargetSwarm::operator=(const TargetSwarm& other) {
+    count = other.count;
+    std::copy_n(other.x.begin(), count, x.begin());
+    std::copy_n(other.y.begin(), count, y.begin());
+    std::copy_n(other.vx.begin(), count, vx.begin());
+    std::copy_n(other.vy.begin(), count, vy.begin());
+    std::copy_n(other.radius.begin(), count, radius.begin());
+    std::copy_n(other.lifetime.begin(), count, lifetime.begin());
+    std::copy_n(other.colorIdx.begin(), count, colorIdx.begin());
+    std::copy_n(other.alive.begin(), count, alive.begin());
+    return *this;
+}
+
+void TargetSwarm::clear() {
+    count = 0;
+}
+
+void TargetSwarm::spawn(std::mt19937& gen) {
+    if (count >= MAX_TARGETS) return;
+
+    std::uniform_real_distribution<float> xDist(MAX_RADIUS, GAME_WIDTH - MAX_RADIUS);
+    std::uniform_real_distribution<float> yDist(MAX_RADIUS, GAME_HEIGHT - MAX_RADIUS);
+    std::uniform_real_distribution<float> speedDist(-120.0f, 120.0f);
+    std::uniform_real_distribution<float> lifeDist(4.0f, 8.0f);
+    std::uniform_int_distribution<> radiusDist(MIN_RADIUS, MAX_RADIUS);
+    std::uniform_int_distribution<> colorDist(0, 2);
+
+    int i = count++;
+    x[i] = xDist(gen);
+    y[i] = yDist(gen);
+    vx[i] = speedDist(gen);
+    vy[i] = speedDist(gen);
+    radius[i] = (float)radiusDist(gen);
+    lifetime[i] = lifeDist(gen);
+    colorIdx[i] = (Uint8)colorDist(gen);
+    alive[i] = 1;
+}
+
+void TargetSwarm::update(float dt) {
+    const float minX = MAX_RADIUS, maxX = GAME_WIDTH - MAX_RADIUS;
+    const float minY = MAX_RADIUS, maxY = GAME_HEIGHT - MAX_RADIUS;
+
+    for (int i = 0; i < count; i++) {
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+        lifetime[i] -= dt;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (x[i] < minX || x[i] > maxX) {
+            vx[i] = -vx[i];
+            x[i] = std::max(minX, std::min(maxX, x[i]));
+        }
+        if (y[i] < minY || y[i] > maxY) {
+            vy[i] = -vy[i];
+            y[i] = std::max(minY, std::min(maxY, y[i]));
+        }
+        if (lifetime[i] <= 0) alive[i] = 0;
+    }
+}
+
+void TargetSwarm::rebuildGrid() {
+    const int numCells = GRID_COLS * GRID_ROWS;
+    std::fill(cellStart.begin(), cellStart.end(), 0);
+
+    for (int i = 0; i < count; i++) {
+        int cx = std::max(0, std::min(GRID_COLS - 1, (int)x[i] / CELL_SIZE));
+        int cy = std::max(0, std::min(GRID_ROWS - 1, (int)y[i] / CELL_SIZE));
+        cellOf[i] = cy * GRID_COLS + cx;
+        cellStart[cellOf[i] + 1]++;
+    }
+    for (int c = 0; c < numCells; c++) {
+        cellStart[c + 1] += cellStart[c];
+    }
+
+    std::copy(cellStart.begin(), cellStart.end() - 1, cellCursor.begin());
+    for (int i = 0; i < count; i++) {
+        int k = cellCursor[cellOf[i]]++;
+        sortedIdx[k] = i;
+        sortedX[k] = x[i];
+        sortedY[k] = y[i];
+        sortedR2[k] = radius[i] * radius[i];
+    }
+}
+
+int TargetSwarm::hitTest(float hx, float hy) {
+    int cx = (int)hx / CELL_SIZE;
+    int cy = (int)hy / CELL_SIZE;
+    int col0 = std::max(0, cx - 1), col1 = std::min(GRID_COLS - 1, cx + 1);
+    int row0 = std::max(0, cy - 1), row1 = std::min(GRID_ROWS - 1, cy + 1);
+    if (col0 > col1 || row0 > row1) return 0;
+
+    const float* px = sortedX.data();
+    const float* py = sortedY.data();
+    const float* pr2 = sortedR2.data();
+    Uint8* mask = hitMask.data();
+
+    int hits = 0;
+    for (int row = row0; row <= row1; row++) {
+        int begin = cellStart[row * GRID_COLS + col0];
+        int end = cellStart[row * GRID_COLS + col1 + 1];
+
+        for (int k = begin; k < end; k++) {
+            float dx = hx - px[k];
+            float dy = hy - py[k];
+            mask[k] = (Uint8)(dx * dx + dy * dy < pr2[k]);
+        }
+        for (int k = begin; k < end; k++) {
+            int i = sortedIdx[k];
+            if (mask[k] && alive[i]) {
+                alive[i] = 0;
+                hits++;
+            }
+        }
+    }
+    return hits;
+}
+
+int TargetSwarm::compact() {
+    int removed = 0;
+    int i = 0;
+    while (i < count) {
+        if (alive[i]) { i++; continue; }
+        int last = --count;
+        x[i] = x[last];
+        y[i] = y[last];
+        vx[i] = vx[last];
+        vy[i] = vy[last];
+        radius[i] = radius[last];
+        lifetime[i] = lifetime[last];
+        colorIdx[i] = colorIdx[last];
+        alive[i] = alive[last];
+        removed++;
+    }
+    return removed;
+}
+
+void TargetSwarm::draw(SDL_Renderer* renderer) {
+    Color colors[] = {RED, ORANGE, YELLOW};
+    for (int c = 0; c < 3; c++) {
+        spans.clear();
+        for (int i = 0; i < count; i++) {
+            if (colorIdx[i] != c) continue;
+            int r = (int)radius[i];
+            int top = (int)y[i] - r;
+            for (int row = 0; row < r * 2; row++) {
+                int hw = halfWidth[r][row];
+                if (hw == 0) continue;
+                spans.push_back({(int)x[i] - hw, top + row, hw * 2, 1});
+            }
+        }
+        if (spans.empty()) continue;
+        SDL_SetRenderDrawColor(renderer, colors[c].r, colors[c].g, colors[c].b, 255);
+        SDL_RenderFillRects(renderer, spans.data(), (int)spans.size());
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef TARGET_SWARM_H
+#define TARGET_SWARM_H
+
+#include "common.h"
+
+// Structure-of-arrays target storage for boxing swarm mode. Targets are bucketed
+// into a uniform grid every tick so a hand only tests the 3x3 cells around it;
+// each cell row is contiguous after the counting sort, so the squared-distance
+// loops run over flat float arrays the compiler can vectorize.
+class TargetSwarm {
+public:
+    static const int MAX_TARGETS = 1024;
+    static const int MIN_RADIUS = 10;
+    static const int MAX_RADIUS = 20;
+    static const int CELL_SIZE = 32;
+    static const int GRID_COLS = (GAME_WIDTH + CELL_SIZE - 1) / CELL_SIZE;
+    static const int GRID_ROWS = (GAME_HEIGHT + CELL_SIZE - 1) / CELL_SIZE;
+
+    int count = 0;
+    std::vector<float> x, y, vx, vy, radius, lifetime;
+    std::vector<Uint8> colorIdx;
+    std::vector<Uint8> alive;
+
+    TargetSwarm();
+    TargetSwarm(const TargetSwarm& other) = default;
+
+    // Game states are copied on every publish; only live targets are. The
+    // grid is rebuilt every tick, so its scratch is left alone.
+    TargetSwarm& operator=(const TargetSwarm& other);
+
+    void clear();
+    void spawn(std::mt19937& gen);
+    void update(float dt);
+    void rebuildGrid();
+    int hitTest(float hx, float hy);
+    int compact();
+    void draw(SDL_Renderer* renderer);
+
+private:
+    std::vector<int> cellOf;
+    std::vector<int> cellStart;
+    std::vector<int> cellCursor;
+    std::vector<int> sortedIdx;
+    std::vector<float> sortedX, sortedY, sortedR2;
+    std::vector<Uint8> hitMask;
+    std::vector<SDL_Rect> spans;
+    int halfWidth[MAX_RADIUS + 1][MAX_RADIUS * 2];
+};
+
+#endif
@@ -1,4 +1,10 @@
 #include "tennis_game.h"
+#include "session.h"
+#include "audio_engine.h"
+
+const double SWING_HIT_WINDOW = 0.4;
+const float POWER_SHOT_BOOST = 1.3f;
+const float POWER_SHOT_MAX_SPEED = 20.0f;
 
 struct TennisBall {
     float x, y;
@@ -8,73 +14,73 @@ struct TennisBall {
     bool goingRight = true;
 };
 
-void runTennis(SDL_Renderer* renderer, PoseDetector& poseDetector, cv::VideoCapture& cap,
-               bool useCamera, cv::Mat& currentFrame, bool& returnToMenu) {
+struct TennisState {
     TennisBall ball;
     int playerScore = 0, aiScore = 0;
     float playerY = GAME_HEIGHT / 2.0f;
     float aiY = GAME_HEIGHT / 2.0f;
-    bool running = true;
-    
-    std::random_device rd;
-    std::mt19937 gen(rd());
-
-    auto resetBall = [&](bool toPlayer) {
-        ball.x = toPlayer ? GAME_WIDTH - 100 : 100;
-        ball.y = GAME_HEIGHT / 2.0f;
-        ball.speedX = toPlayer ? -8.0f : 8.0f;
-        ball.speedY = ((std::rand() % 100) / 100.0f - 0.5f) * 6.0f;
-        ball.active = true;
-        ball.goingRight = !toPlayer;
-    };
-    
-    resetBall(true);
-
-    while (running && !returnToMenu) {
-        SDL_Event event;
-        while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_QUIT) { running = false; returnToMenu = false; }
-            else if (event.type == SDL_KEYDOWN) {
-                if (event.key.keysym.sym == SDLK_ESCAPE) returnToMenu = true;
-                if (event.key.keysym.sym == SDLK_q) returnToMenu = true;
-            }
+    double lastSwingTime = -1;
+};
+
+class TennisGame : public Game {
+public:
+    TennisGame() : gen(sessionSeed()), state(TennisState()) {
+        resetBall(state.back(), true);
+        state.publish();
+    }
+
+    PoseMode poseMode() const override { return POSE_ARM; }
+
+    void update(float, const GameInput& input) override {
+        TennisState& s = state.back();
+        TennisBall& ball = s.ball;
+
+        // Swinging as the ball reaches the racket returns it harder.
+        for (const GestureEvent& gesture : input.pose.gestures) {
+            if (gesture.type == GESTURE_SWING_START) s.lastSwingTime = gesture.time;
         }
 
-        if (useCamera && cap.read(currentFrame)) {
-            cv::flip(currentFrame, currentFrame, 1);
-            float armY = poseDetector.detectArmPosition(currentFrame);
-            playerY = armY * GAME_HEIGHT;
+        if (input.pose.detected) {
+            s.playerY = input.pose.armY * GAME_HEIGHT;
         } else {
-            const Uint8* keys = SDL_GetKeyboardState(NULL);
-            if (keys[SDL_SCANCODE_W] || keys[SDL_SCANCODE_UP]) playerY -= 8;
-            if (keys[SDL_SCANCODE_S] || keys[SDL_SCANCODE_DOWN]) playerY += 8;
+            if (input.keys[SDL_SCANCODE_W] || input.keys[SDL_SCANCODE_UP]) s.playerY -= 8;
+            if (input.keys[SDL_SCANCODE_S] || input.keys[SDL_SCANCODE_DOWN]) s.playerY += 8;
         }
-        playerY = std::max(50.0f, std::min((float)GAME_HEIGHT - 50, playerY));
+        s.playerY = std::max(50.0f, std::min((float)GAME_HEIGHT - 50, s.playerY));
 
         if (ball.goingRight) {
-            aiY += (ball.y - aiY) * 0.05f;
+            s.aiY += (ball.y - s.aiY) * 0.05f;
         }
-        aiY = std::max(50.0f, std::min((float)GAME_HEIGHT - 50, aiY));
+        s.aiY = std::max(50.0f, std::min((float)GAME_HEIGHT - 50, s.aiY));
 
         ball.x += ball.speedX;
         ball.y += ball.speedY;
 
         if (ball.y < 30 || ball.y > GAME_HEIGHT - 30) ball.speedY *= -1;
 
-        if (ball.x < 80 && std::abs(ball.y - playerY) < 60 && !ball.goingRight) {
+        if (ball.x < 80 && std::abs(ball.y - s.playerY) < 60 && !ball.goingRight) {
             ball.speedX = std::abs(ball.speedX) * 1.05f;
-            ball.speedY = (ball.y - playerY) * 0.1f;
+            ball.speedY = (ball.y - s.playerY) * 0.1f;
+            if (s.lastSwingTime >= 0 && input.time - s.lastSwingTime < SWING_HIT_WINDOW) {
+                ball.speedX = std::max(ball.speedX, std::min(ball.speedX * POWER_SHOT_BOOST, POWER_SHOT_MAX_SPEED));
+                s.lastSwingTime = -1;
+            }
             ball.goingRight = true;
+            sfxPlay(SFX_RETURN);
         }
-        if (ball.x > GAME_WIDTH - 80 && std::abs(ball.y - aiY) < 60 && ball.goingRight) {
+        if (ball.x > GAME_WIDTH - 80 && std::abs(ball.y - s.aiY) < 60 && ball.goingRight) {
             ball.speedX = -std::abs(ball.speedX) * 1.02f;
-            ball.speedY = (ball.y - aiY) * 0.08f;
+            ball.speedY = (ball.y - s.aiY) * 0.08f;
             ball.goingRight = false;
+            sfxPlay(SFX_RETURN);
         }
 
-        if (ball.x < 0) { aiScore++; resetBall(true); }
-        if (ball.x > GAME_WIDTH) { playerScore++; resetBall(false); }
+        if (ball.x < 0) { s.aiScore++; resetBall(s, true); }
+        if (ball.x > GAME_WIDTH) { s.playerScore++; resetBall(s, false); }
+    }
 
+    void render(SDL_Renderer* renderer) override {
+        const TennisState& s = state.front();
         SDL_SetRenderDrawColor(renderer, 50, 100, 50, 255);
         SDL_Rect bg = {0, 0, GAME_WIDTH, GAME_HEIGHT};
         SDL_RenderFillRect(renderer, &bg);
@@ -85,22 +91,37 @@ void runTennis(SDL_Renderer* renderer, PoseDetector& poseDetector, cv::VideoCapt
         SDL_RenderDrawLine(renderer, 0, GAME_HEIGHT - 30, GAME_WIDTH, GAME_HEIGHT - 30);
 
         SDL_SetRenderDrawColor(renderer, BLUE.r, BLUE.g, BLUE.b, BLUE.a);
-        SDL_Rect playerRacket = {30, (int)playerY - 40, 20, 80};
+        SDL_Rect playerRacket = {30, (int)s.playerY - 40, 20, 80};
         SDL_RenderFillRect(renderer, &playerRacket);
 
         SDL_SetRenderDrawColor(renderer, RED.r, RED.g, RED.b, RED.a);
-        SDL_Rect aiRacket = {GAME_WIDTH - 50, (int)aiY - 40, 20, 80};
+        SDL_Rect aiRacket = {GAME_WIDTH - 50, (int)s.aiY - 40, 20, 80};
         SDL_RenderFillRect(renderer, &aiRacket);
 
         SDL_SetRenderDrawColor(renderer, YELLOW.r, YELLOW.g, YELLOW.b, YELLOW.a);
-        drawFilledCircle(renderer, (int)ball.x, (int)ball.y, ball.radius);
+        drawFilledCircle(renderer, (int)s.ball.x, (int)s.ball.y, s.ball.radius);
 
         SDL_SetRenderDrawColor(renderer, WHITE.r, WHITE.g, WHITE.b, WHITE.a);
-        drawNumber(renderer, playerScore, 150, 50, 40);
-        drawNumber(renderer, aiScore, GAME_WIDTH - 200, 50, 40);
+        drawNumber(renderer, s.playerScore, 150, 50, 40);
+        drawNumber(renderer, s.aiScore, GAME_WIDTH - 200, 50, 40);
+    }
+
+    void publish() override { state.publish(); }
 
-        drawCameraFeed(renderer, currentFrame, useCamera);
-        SDL_RenderPresent(renderer);
-        SDL_Delay(16);
+private:
+    std::mt19937 gen;
+    DoubleBuffer<TennisState> state;
+
+    void resetBall(TennisState& s, bool toPlayer) {
+        s.ball.x = toPlayer ? GAME_WIDTH - 100 : 100;
+        s.ball.y = GAME_HEIGHT / 2.0f;
+        s.ball.speedX = toPlayer ? -8.0f : 8.0f;
+        s.ball.speedY = ((gen() % 100) / 100.0f - 0.5f) * 6.0f;
+        s.ball.active = true;
+        s.ball.goingRight = !toPlayer;
     }
+};
+
+std::unique_ptr<Game> createTennis(Mix_Music*) {
+    return std::make_unique<TennisGame>();
 }
@@ -1,9 +1,8 @@
 #ifndef TENNIS_GAME_H
 #define TENNIS_GAME_H
 
-#include "common.h"
+#include "game.h"
 
-void runTennis(SDL_Renderer* renderer, PoseDetector& poseDetector, cv::VideoCapture& cap,
-               bool useCamera, cv::Mat& currentFrame, bool& returnToMenu);
+std::unique_ptr<Game> createTennis(Mix_Music* menuMusic);
 
 #endif
@@ -0,0 +1,156 @@
+#include "thread_config.h"
+#include <atomic>
+#include <map>
+#include <sstream>
+#include <thread>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+static std::atomic<int> audioCpu{AUDIO_CPU_NONE};
+static std::atomic<bool> audioPinned{false};
+
+static int readInt(const std::string& path, int fallback) {
+    std::ifstream in(path);
+    int value;
+    return (in >> value) ? value : fallback;
+}
+
+static std::vector<int> allowedCpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+#endif
+    if (cpus.empty()) {
+        int count = std::max(1, (int)std::thread::hardware_concurrency());
+        for (int cpu = 0; cpu < count; cpu++) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+static bool pinCurrentThread(const std::vector<int>& cpus) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+// SMT siblings share a core_id within a package; without sysfs every
+// logical CPU counts as its own core.
+std::vector<std::vector<int>> threadConfigCores() {
+    std::map<std::pair<int, int>, std::vector<int>> byCore;
+    for (int cpu : allowedCpus()) {
+        std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+        int package = readInt(base + "physical_package_id", 0);
+        int core = readInt(base + "core_id", cpu);
+        byCore[{package, core}].push_back(cpu);
+    }
+    std::vector<std::vector<int>> cores;
+    for (const auto& entry : byCore) cores.push_back(entry.second);
+    std::sort(cores.begin(), cores.end());
+    return cores;
+}
+
+bool threadConfigParseCpus(const std::string& list, std::vector<int>& cpus) {
+    cpus.clear();
+    std::stringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        std::istringstream range(item);
+        int first, last;
+        char dash;
+        if (!(range >> first)) return false;
+        last = first;
+        if (range >> dash && (dash != '-' || !(range >> last))) return false;
+        if (first < 0 || last < first) return false;
+        for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+    }
+    return !cpus.empty();
+}
+
+ThreadConfig threadConfigResolve(const ThreadConfig& config) {
+    ThreadConfig resolved = config;
+    std::vector<std::vector<int>> cores = threadConfigCores();
+
+    std::vector<int> audioCore;
+    if (resolved.audioCpu == AUDIO_CPU_AUTO) {
+        if ((int)cores.size() >= AUDIO_RESERVE_MIN_CORES) audioCore = cores.back();
+        resolved.audioCpu = audioCore.empty() ? AUDIO_CPU_NONE : audioCore.front();
+    } else if (resolved.audioCpu >= 0) {
+        for (const std::vector<int>& core : cores) {
+            if (std::find(core.begin(), core.end(), resolved.audioCpu) != core.end()) audioCore = core;
+        }
+        if (audioCore.empty()) audioCore.push_back(resolved.audioCpu);
+    }
+
+    if (resolved.mainCpus.empty()) {
+        for (const std::vector<int>& core : cores) {
+            if (core != audioCore) resolved.mainCpus.insert(resolved.mainCpus.end(), core.begin(), core.end());
+        }
+        if (resolved.mainCpus.empty()) resolved.mainCpus = cores.front();
+    }
+
+    if (resolved.inferenceThreads <= 0) {
+        int mainCores = 0;
+        for (const std::vector<int>& core : cores) {
+            for (int cpu : core) {
+                if (std::find(resolved.mainCpus.begin(), resolved.mainCpus.end(), cpu) != resolved.mainCpus.end()) {
+                    mainCores++;
+                    break;
+                }
+            }
+        }
+        resolved.inferenceThreads = std::max(1, mainCores);
+    }
+    return resolved;
+}
+
+static std::string formatCpus(const std::vector<int>& cpus) {
+    std::ostringstream out;
+    for (size_t i = 0; i < cpus.size(); i++) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) j++;
+        if (i > 0) out << ",";
+        out << cpus[i];
+        if (j > i) out << "-" << cpus[j];
+        i = j;
+    }
+    return out.str();
+}
+
+std::string threadConfigDescribe(const ThreadConfig& config) {
+    std::ostringstream out;
+    out << config.inferenceThreads << " inference threads, game loop on CPUs " << formatCpus(config.mainCpus)
+        << ", audio " << (config.audioCpu >= 0 ? "on CPU " + std::to_string(config.audioCpu) : std::string("unpinned"));
+    return out.str();
+}
+
+void threadConfigApply(const ThreadConfig& config) {
+    // Pin first so the inference workers OpenCV starts next inherit the set.
+    if (!config.mainCpus.empty() && !pinCurrentThread(config.mainCpus)) {
+#ifdef __linux__
+        std::cerr << "Could not pin the game loop to CPUs " << formatCpus(config.mainCpus) << std::endl;
+#endif
+    }
+    cv::setNumThreads(config.inferenceThreads);
+    audioCpu.store(config.audioCpu);
+    audioPinned.store(false);
+}
+
+void threadConfigAudioThread() {
+    if (audioPinned.load(std::memory_order_relaxed) || audioPinned.exchange(true)) return;
+    int cpu = audioCpu.load();
+    if (cpu >= 0) pinCurrentThread(std::vector<int>(1, cpu));
+}
@@ -0,0 +1,34 @@
+#ifndef THREAD_CONFIG_H
+#define THREAD_CONFIG_H
+
+#include "common.h"
+#include <string>
+
+// Which CPUs the game uses for what. The game loop thread (capture, pose
+// inference, simulation and rendering) is pinned to mainCpus before any other
+// thread starts, so OpenCV's inference workers and the background loader
+// threads inherit that set. The SDL audio thread pins itself to audioCpu on
+// its first callback, which keeps the mixer off the busy cores. Pinning is
+// only available on Linux; elsewhere just the OpenCV thread count applies.
+const int AUDIO_CPU_AUTO = -2;
+const int AUDIO_CPU_NONE = -1;
+const int AUDIO_RESERVE_MIN_CORES = 4;
+
+struct ThreadConfig {
+    int inferenceThreads = 0;        // 0: one per physical core in mainCpus
+    std::vector<int> mainCpus;       // empty: every CPU not reserved for audio
+    int audioCpu = AUDIO_CPU_AUTO;   // AUTO reserves the last physical core on 4+ core machines
+};
+
+// Physical cores available to the process, each with its logical CPUs.
+std::vector<std::vector<int>> threadConfigCores();
+
+bool threadConfigParseCpus(const std::string& list, std::vector<int>& cpus);
+ThreadConfig threadConfigResolve(const ThreadConfig& config);
+std::string threadConfigDescribe(const ThreadConfig& config);
+
+// Applies a resolved config to the calling thread and OpenCV.
+void threadConfigApply(const ThreadConfig& config);
+void threadConfigAudioThread();
+
+#endif
@@ -0,0 +1,223 @@
+#include "trace.h"
+#include <atomic>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t duration;
+};
+
+const size_t TRACE_BUFFER_SIZE = 1 << 16;
+
+const int TRACE_FILE = 1;
+const int TRACE_STATS = 2;
+
+struct StageStat {
+    const char* name = nullptr;
+    std::atomic<double> averageMs{0};
+};
+
+const int MAX_STAGE_STATS = 32;
+const double STAGE_STAT_SMOOTHING = 0.1;
+
+// Written only by its owning thread; the head and the stat count are
+// published with release ordering so traceStop and the HUD see complete
+// entries. The event ring is only allocated for threads that start while
+// a trace file is being written.
+struct TraceBuffer {
+    std::vector<TraceEvent> events;
+    std::atomic<uint64_t> head{0};
+    int tid = 0;
+    std::atomic<const char*> threadName{nullptr};
+    StageStat stats[MAX_STAGE_STATS];
+    std::atomic<int> numStats{0};
+};
+
+std::atomic<int> activeFlags{0};
+std::string outputPath;
+std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<TraceBuffer>> registry;
+thread_local TraceBuffer* localBuffer = nullptr;
+
+TraceBuffer* threadBuffer() {
+    if (!localBuffer) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.emplace_back(new TraceBuffer);
+        localBuffer = registry.back().get();
+        localBuffer->tid = (int)registry.size();
+        if (activeFlags.load() & TRACE_FILE) localBuffer->events.resize(TRACE_BUFFER_SIZE);
+    }
+    return localBuffer;
+}
+
+void recordStageStat(TraceBuffer* buffer, const char* name, uint64_t duration) {
+    double ms = duration / 1e6;
+    int count = buffer->numStats.load(std::memory_order_relaxed);
+    for (int i = 0; i < count; i++) {
+        StageStat& stat = buffer->stats[i];
+        if (std::strcmp(stat.name, name) == 0) {
+            double average = stat.averageMs.load(std::memory_order_relaxed);
+            stat.averageMs.store(average + (ms - average) * STAGE_STAT_SMOOTHING, std::memory_order_relaxed);
+            return;
+        }
+    }
+    if (count < MAX_STAGE_STATS) {
+        buffer->stats[count].name = name;
+        buffer->stats[count].averageMs.store(ms, std::memory_order_relaxed);
+        buffer->numStats.store(count + 1, std::memory_order_release);
+    }
+}
+
+void writeEscaped(std::ostream& out, const char* s) {
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') out << '\\';
+        out << *s;
+    }
+}
+
+}
+
+uint64_t traceNow() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch).count();
+}
+
+bool traceActive() {
+    return activeFlags.load(std::memory_order_relaxed) != 0;
+}
+
+void traceStart(const std::string& path) {
+#ifndef MOTION_TRACE
+    std::cerr << "Tracing was not compiled in (configure with -DMOTION_TRACE=ON); "
+              << "only the trace file header will be written." << std::endl;
+#endif
+    outputPath = path;
+    epoch = std::chrono::steady_clock::now();
+    activeFlags.fetch_or(TRACE_FILE);
+    traceSetThreadName("main");
+    std::cout << "Tracing to " << path << std::endl;
+}
+
+void traceSetThreadName(const char* name) {
+    if (!(activeFlags.load() & TRACE_FILE)) return;
+    threadBuffer()->threadName.store(name);
+}
+
+void traceRecord(const char* name, uint64_t start, uint64_t end) {
+    int flags = activeFlags.load(std::memory_order_relaxed);
+    if (!flags) return;
+    TraceBuffer* buffer = threadBuffer();
+    if ((flags & TRACE_FILE) && !buffer->events.empty()) {
+        uint64_t head = buffer->head.load(std::memory_order_relaxed);
+        buffer->events[head & (TRACE_BUFFER_SIZE - 1)] = {name, start, end - start};
+        buffer->head.store(head + 1, std::memory_order_release);
+    }
+    if (flags & TRACE_STATS) {
+        recordStageStat(buffer, name, end - start);
+    }
+}
+
+void traceSetStageStats(bool enabled) {
+    if (enabled) {
+        activeFlags.fetch_or(TRACE_STATS);
+    } else {
+        activeFlags.fetch_and(~TRACE_STATS);
+    }
+}
+
+// A stage timed on several threads, such as the pipeline workers' inference,
+// reports the mean of their averages.
+double traceStageMs(const char* name) {
+    double sum = 0;
+    int threads = 0;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const auto& buffer : registry) {
+        int count = buffer->numStats.load(std::memory_order_acquire);
+        for (int i = 0; i < count; i++) {
+            if (std::strcmp(buffer->stats[i].name, name) == 0) {
+                sum += buffer->stats[i].averageMs.load(std::memory_order_relaxed);
+                threads++;
+                break;
+            }
+        }
+    }
+    return threads > 0 ? sum / threads : -1;
+}
+
+void traceStop() {
+    if (!(activeFlags.fetch_and(~TRACE_FILE) & TRACE_FILE)) return;
+
+    std::ofstream out(outputPath);
+    if (!out) {
+        std::cerr << "Could not write trace file: " << outputPath << std::endl;
+        return;
+    }
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"motion_control\"}}";
+
+    size_t total = 0;
+    size_t dropped = 0;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const auto& buffer : registry) {
+        const char* threadName = buffer->threadName.load();
+        if (threadName) {
+            out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"args\":{\"name\":\"";
+            writeEscaped(out, threadName);
+            out << "\"}}";
+        }
+
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t first = head > TRACE_BUFFER_SIZE ? head - TRACE_BUFFER_SIZE : 0;
+        dropped += (size_t)first;
+        for (uint64_t i = first; i < head; i++) {
+            const TraceEvent& e = buffer->events[i & (TRACE_BUFFER_SIZE - 1)];
+            out << ",\n{\"name\":\"";
+            writeEscaped(out, e.name);
+            out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"ts\":" << e.start / 1000.0 << ",\"dur\":" << e.duration / 1000.0 << "}";
+            total++;
+        }
+    }
+    out << "\n]}\n";
+
+    std::cout << "Trace written to " << outputPath << " (" << total << " events";
+    if (dropped > 0) std::cout << ", " << dropped << " overwritten";
+    std::cout << ")" << std::endl;
+}
+
+TraceScope::TraceScope(const char* name) : name(nullptr), start(0) {
+    if (traceActive()) {
+        this->name = name;
+        start = traceNow();
+    }
+}
+
+TraceScope::~TraceScope() {
+    if (name) traceRecord(name, start, traceNow());
+}
+
+void TraceScope::next(const char* name) {
+    if (!traceActive()) {
+        this->name = nullptr;
+        return;
+    }
+    uint64_t now = traceNow();
+    if (this->name) traceRecord(this->name, start, now);
+    this->name = name;
+    start = now;
+}
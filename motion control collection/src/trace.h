@@ -0,0 +1,51 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <string>
+
+// Scoped trace markers written to Chrome/Perfetto trace-event JSON.
+//
+// Each thread appends complete events to its own fixed-size ring buffer, so
+// recording never takes a lock; the oldest events are overwritten if a session
+// outlives the buffer. Markers cost one atomic load while tracing is off and
+// disappear entirely when MOTION_TRACE is not defined. Event names must be
+// string literals.
+//
+// The same markers can also keep a smoothed per-stage duration for the
+// performance HUD without writing a trace file. Those live in the same
+// per-thread buffers, so the markers stay lock-free with the HUD open.
+
+void traceStart(const std::string& path);
+void traceStop();
+bool traceActive();
+void traceSetThreadName(const char* name);
+uint64_t traceNow();
+void traceRecord(const char* name, uint64_t start, uint64_t end);
+void traceSetStageStats(bool enabled);
+double traceStageMs(const char* name);
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name);
+    ~TraceScope();
+    void next(const char* name);
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+#ifdef MOTION_TRACE
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define TRACE_STAGE(name) TraceScope traceStage_(name)
+#define TRACE_NEXT_STAGE(name) traceStage_.next(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_STAGE(name) ((void)0)
+#define TRACE_NEXT_STAGE(name) ((void)0)
+#endif
+
+#endif
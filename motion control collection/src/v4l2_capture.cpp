@@ -0,0 +1,226 @@
+#include "v4l2_capture.h"
+
+#ifdef __linux__
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/videodev2.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+static const int FRAME_WAIT_MS = 1000;
+
+static int xioctl(int fd, unsigned long request, void* arg) {
+    int r;
+    do {
+        r = ioctl(fd, request, arg);
+    } while (r < 0 && errno == EINTR);
+    return r;
+}
+
+static double monotonicSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+V4l2Camera::~V4l2Camera() {
+    close();
+}
+
+bool V4l2Camera::open(const std::string& device, int requestedWidth, int requestedHeight, double fps) {
+    close();
+    devicePath = device;
+    fd = ::open(device.c_str(), O_RDWR | O_NONBLOCK);
+    if (fd < 0) {
+        std::cerr << "Could not open " << device << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    v4l2_capability caps = {};
+    Uint32 flags = 0;
+    if (xioctl(fd, VIDIOC_QUERYCAP, &caps) == 0) {
+        flags = (caps.capabilities & V4L2_CAP_DEVICE_CAPS) ? caps.device_caps : caps.capabilities;
+    }
+    if (!(flags & V4L2_CAP_VIDEO_CAPTURE) || !(flags & V4L2_CAP_STREAMING)) {
+        std::cerr << device << " is not a streaming V4L2 capture device" << std::endl;
+        close();
+        return false;
+    }
+
+    if (!setFormat(V4L2_PIX_FMT_YUYV, requestedWidth, requestedHeight) &&
+        !setFormat(V4L2_PIX_FMT_MJPEG, requestedWidth, requestedHeight)) {
+        std::cerr << device << " offers neither YUYV nor MJPEG capture" << std::endl;
+        close();
+        return false;
+    }
+
+    // The driver picks the nearest rate it supports; failure just leaves the default.
+    v4l2_streamparm parm = {};
+    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    parm.parm.capture.timeperframe.numerator = 1;
+    parm.parm.capture.timeperframe.denominator = (Uint32)std::max(1.0, std::round(fps));
+    xioctl(fd, VIDIOC_S_PARM, &parm);
+    double actualFps = parm.parm.capture.timeperframe.numerator > 0
+        ? (double)parm.parm.capture.timeperframe.denominator / parm.parm.capture.timeperframe.numerator : fps;
+
+    if (!startStreaming()) {
+        close();
+        return false;
+    }
+    std::cout << "V4L2 camera " << device << ": " << width << "x" << height << " "
+              << (pixelFormat == V4L2_PIX_FMT_YUYV ? "YUYV" : "MJPEG") << " at " << actualFps
+              << " fps, " << bufferCount << " buffers" << std::endl;
+    return true;
+}
+
+bool V4l2Camera::setFormat(Uint32 format, int requestedWidth, int requestedHeight) {
+    v4l2_format fmt = {};
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    fmt.fmt.pix.width = requestedWidth;
+    fmt.fmt.pix.height = requestedHeight;
+    fmt.fmt.pix.pixelformat = format;
+    fmt.fmt.pix.field = V4L2_FIELD_ANY;
+    if (xioctl(fd, VIDIOC_S_FMT, &fmt) < 0 || fmt.fmt.pix.pixelformat != format) {
+        return false;
+    }
+    pixelFormat = format;
+    width = fmt.fmt.pix.width;
+    height = fmt.fmt.pix.height;
+    bytesPerLine = std::max((int)fmt.fmt.pix.bytesperline, width * 2);
+    return true;
+}
+
+bool V4l2Camera::startStreaming() {
+    v4l2_requestbuffers request = {};
+    request.count = V4L2_BUFFER_COUNT;
+    request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    request.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(fd, VIDIOC_REQBUFS, &request) < 0 || request.count < 2) {
+        std::cerr << devicePath << " does not support memory-mapped capture" << std::endl;
+        return false;
+    }
+
+    for (Uint32 i = 0; i < std::min(request.count, (Uint32)V4L2_BUFFER_COUNT); i++) {
+        v4l2_buffer buf = {};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+        if (xioctl(fd, VIDIOC_QUERYBUF, &buf) < 0) {
+            std::cerr << "Could not query V4L2 buffer: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        void* start = mmap(nullptr, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buf.m.offset);
+        if (start == MAP_FAILED) {
+            std::cerr << "Could not map V4L2 buffer: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        buffers[i].start = start;
+        buffers[i].length = buf.length;
+        bufferCount++;
+        if (xioctl(fd, VIDIOC_QBUF, &buf) < 0) {
+            std::cerr << "Could not queue V4L2 buffer: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+    }
+
+    v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(fd, VIDIOC_STREAMON, &type) < 0) {
+        std::cerr << "Could not start V4L2 streaming: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    streaming = true;
+    return true;
+}
+
+void V4l2Camera::close() {
+    if (streaming) {
+        v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        xioctl(fd, VIDIOC_STREAMOFF, &type);
+        streaming = false;
+    }
+    for (int i = 0; i < bufferCount; i++) {
+        munmap(buffers[i].start, buffers[i].length);
+        buffers[i] = Buffer();
+    }
+    bufferCount = 0;
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool V4l2Camera::read(cv::Mat& frame) {
+    if (!streaming) return false;
+
+    v4l2_buffer newest = {};
+    bool have = false;
+    for (;;) {
+        v4l2_buffer buf = {};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        if (xioctl(fd, VIDIOC_DQBUF, &buf) == 0) {
+            if (buf.flags & V4L2_BUF_FLAG_ERROR) {
+                xioctl(fd, VIDIOC_QBUF, &buf);
+                continue;
+            }
+            if (have) {
+                xioctl(fd, VIDIOC_QBUF, &newest);
+                skipped++;
+            }
+            newest = buf;
+            have = true;
+            continue;
+        }
+        if (errno != EAGAIN) {
+            std::cerr << "V4L2 capture failed: " << std::strerror(errno) << std::endl;
+            if (have) xioctl(fd, VIDIOC_QBUF, &newest);
+            return false;
+        }
+        if (have) break;
+
+        pollfd waitFor = {fd, POLLIN, 0};
+        int ready = poll(&waitFor, 1, FRAME_WAIT_MS);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) {
+            std::cerr << "No frame from " << devicePath << " within " << FRAME_WAIT_MS << " ms" << std::endl;
+            return false;
+        }
+    }
+
+    void* data = buffers[newest.index].start;
+    if (pixelFormat == V4L2_PIX_FMT_YUYV) {
+        cv::cvtColor(cv::Mat(height, width, CV_8UC2, data, bytesPerLine), frame, cv::COLOR_YUV2BGR_YUYV);
+    } else {
+        cv::imdecode(cv::Mat(1, (int)newest.bytesused, CV_8U, data), cv::IMREAD_COLOR, &frame);
+    }
+    xioctl(fd, VIDIOC_QBUF, &newest);
+    if (frame.empty()) return false;
+
+    lastTimestamp = newest.timestamp.tv_sec + newest.timestamp.tv_usec / 1e6;
+    bool monotonic = (newest.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+    lastAge = monotonic ? std::max(0.0, monotonicSeconds() - lastTimestamp) : 0;
+    totalAge += lastAge;
+    delivered++;
+    return true;
+}
+
+#else
+
+V4l2Camera::~V4l2Camera() {}
+
+bool V4l2Camera::open(const std::string& device, int, int, double) {
+    std::cerr << "V4L2 capture is only available on Linux (" << device << ")" << std::endl;
+    return false;
+}
+
+bool V4l2Camera::setFormat(Uint32, int, int) { return false; }
+bool V4l2Camera::startStreaming() { return false; }
+void V4l2Camera::close() {}
+bool V4l2Camera::read(cv::Mat&) { return false; }
+
+#endif
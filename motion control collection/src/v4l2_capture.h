@@ -0,0 +1,59 @@
+#ifndef V4L2_CAPTURE_H
+#define V4L2_CAPTURE_H
+
+#include "common.h"
+#include <string>
+
+// Direct Video4Linux2 camera capture (Linux only). Frames are captured into
+// memory-mapped driver buffers and decoded straight out of them. Every read
+// drains the queue and keeps only the newest filled buffer, handing the rest
+// back to the driver, so a slow game loop never works through a backlog of
+// stale frames. YUYV is preferred because it needs no decoding; MJPEG is the
+// fallback for cameras that only stream compressed frames at the requested
+// size.
+const int V4L2_BUFFER_COUNT = 4;
+
+class V4l2Camera {
+public:
+    ~V4l2Camera();
+
+    bool open(const std::string& device, int width, int height, double fps);
+    void close();
+    bool isOpened() const { return fd >= 0; }
+    bool read(cv::Mat& frame);
+
+    // Kernel capture time of the last frame on the CLOCK_MONOTONIC time base,
+    // and how long before read() returned it was captured.
+    double frameTimestamp() const { return lastTimestamp; }
+    double frameAge() const { return lastAge; }
+
+    long framesDelivered() const { return delivered; }
+    long framesSkipped() const { return skipped; }
+    double meanFrameAge() const { return delivered > 0 ? totalAge / delivered : 0; }
+
+private:
+    struct Buffer {
+        void* start = nullptr;
+        size_t length = 0;
+    };
+
+    int fd = -1;
+    std::string devicePath;
+    Uint32 pixelFormat = 0;
+    int width = 0, height = 0;
+    int bytesPerLine = 0;
+    Buffer buffers[V4L2_BUFFER_COUNT];
+    int bufferCount = 0;
+    bool streaming = false;
+
+    double lastTimestamp = 0;
+    double lastAge = 0;
+    long delivered = 0;
+    long skipped = 0;
+    double totalAge = 0;
+
+    bool setFormat(Uint32 format, int width, int height);
+    bool startStreaming();
+};
+
+#endif
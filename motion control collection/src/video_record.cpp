@@ -0,0 +1,184 @@
+#include "video_record.h"
+#include "session.h"
+#include "soak.h"
+#include "trace.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+typedef std::chrono::steady_clock VideoClock;
+
+// A video frame can stand in for at most a second of missed frames; longer
+// gaps (a stall, a debugger) are skipped rather than filled.
+static const double MAX_REPEAT_SECONDS = 1.0;
+
+struct VideoSlot {
+    cv::Mat image;
+    int repeats = 1;
+};
+
+static bool recording = false;
+static std::string videoPath;
+static cv::VideoWriter writer;
+static double frameRate = VIDEO_DEFAULT_FPS;
+
+// Filled slots run from tail to head; the main thread only writes to slots
+// outside that range, the encoder only reads inside it.
+static std::vector<VideoSlot> ring;
+static int head = 0;
+static int tail = 0;
+static int queued = 0;
+static std::thread encoderThread;
+static std::mutex encoderMutex;
+static std::condition_variable encoderCv;
+static bool encoderStopping = false;
+
+static bool started = false;
+static Uint32 startTicks = 0;
+static long nextFrame = 0;
+
+static long framesCaptured = 0;
+static long framesWritten = 0;
+static long framesDropped = 0;
+static long framesSkipped = 0;
+static double readbackMs = 0;
+static double encodeMs = 0;
+
+static double elapsedMs(VideoClock::time_point from) {
+    return std::chrono::duration<double, std::milli>(VideoClock::now() - from).count();
+}
+
+static void encoderLoop() {
+    traceSetThreadName("video-encoder");
+    std::unique_lock<std::mutex> lock(encoderMutex);
+    while (true) {
+        encoderCv.wait(lock, [] { return encoderStopping || queued > 0; });
+        while (queued > 0) {
+            VideoSlot& slot = ring[tail];
+            lock.unlock();
+            VideoClock::time_point start = VideoClock::now();
+            for (int i = 0; i < slot.repeats; i++) writer.write(slot.image);
+            encodeMs += elapsedMs(start);
+            framesWritten += slot.repeats;
+            lock.lock();
+            tail = (tail + 1) % VIDEO_RING_FRAMES;
+            queued--;
+        }
+        if (encoderStopping) break;
+    }
+}
+
+// Replays and soak runs advance session time per game frame, however fast
+// they run; live sessions follow the wall clock, which also covers the menu.
+static Uint32 videoTicks() {
+    return sessionReplaying() || soakActive() ? sessionTicks() : SDL_GetTicks();
+}
+
+static bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool videoRecordStart(const std::string& path, SDL_Renderer* renderer, double fps) {
+    int width, height;
+    if (SDL_GetRendererOutputSize(renderer, &width, &height) != 0) {
+        std::cerr << "Could not read the window size for recording: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    int fourcc = endsWith(path, ".avi") ? cv::VideoWriter::fourcc('M', 'J', 'P', 'G')
+                                        : cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+    if (!writer.open(path, fourcc, fps, cv::Size(width, height))) {
+        std::cerr << "Could not open video file for writing: " << path << std::endl;
+        return false;
+    }
+
+    ring.assign(VIDEO_RING_FRAMES, VideoSlot());
+    for (VideoSlot& slot : ring) slot.image.create(height, width, CV_8UC3);
+    head = tail = queued = 0;
+    encoderStopping = false;
+    started = false;
+    nextFrame = 0;
+    framesCaptured = framesWritten = framesDropped = framesSkipped = 0;
+    readbackMs = encodeMs = 0;
+    frameRate = fps;
+    videoPath = path;
+    recording = true;
+
+    encoderThread = std::thread(encoderLoop);
+    std::cout << "Recording video to " << path << " (" << width << "x" << height << " at " << fps << " fps)"
+              << std::endl;
+    return true;
+}
+
+bool videoRecording() {
+    return recording;
+}
+
+void videoRecordFrame(SDL_Renderer* renderer) {
+    if (!recording) return;
+    Uint32 now = videoTicks();
+    if (!started) {
+        startTicks = now;
+        started = true;
+    }
+    long due = (long)((now - startTicks) / 1000.0 * frameRate);
+    if (due < nextFrame) return;
+
+    // Frames between the last one written and this one were missed, either
+    // because the loop ran slower than the video or because the ring was
+    // full; this frame stands in for them.
+    long missed = due - nextFrame;
+    long repeats = std::min(missed + 1, std::max(1L, (long)(MAX_REPEAT_SECONDS * frameRate)));
+
+    int slotIndex;
+    {
+        std::lock_guard<std::mutex> lock(encoderMutex);
+        if (queued == VIDEO_RING_FRAMES) {
+            framesDropped++;
+            return;
+        }
+        slotIndex = head;
+    }
+
+    VideoSlot& slot = ring[slotIndex];
+    {
+        TRACE_SCOPE("readback");
+        VideoClock::time_point start = VideoClock::now();
+        if (SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_BGR24, slot.image.data, (int)slot.image.step) != 0) {
+            return;
+        }
+        readbackMs += elapsedMs(start);
+    }
+    slot.repeats = (int)repeats;
+    nextFrame = due + 1;
+    framesCaptured++;
+    framesSkipped += missed + 1 - repeats;
+
+    {
+        std::lock_guard<std::mutex> lock(encoderMutex);
+        head = (head + 1) % VIDEO_RING_FRAMES;
+        queued++;
+    }
+    encoderCv.notify_one();
+}
+
+void videoRecordStop() {
+    if (!recording) return;
+    {
+        std::lock_guard<std::mutex> lock(encoderMutex);
+        encoderStopping = true;
+    }
+    encoderCv.notify_one();
+    encoderThread.join();
+    writer.release();
+    recording = false;
+
+    std::cout << "Video " << videoPath << ": " << framesWritten << " frames written from " << framesCaptured
+              << " captured, " << framesDropped << " dropped while the encoder was behind";
+    if (framesSkipped > 0) std::cout << ", " << framesSkipped << " skipped in stalls";
+    std::cout << std::endl;
+    if (framesCaptured > 0) {
+        std::cout << "  readback mean " << readbackMs / framesCaptured << " ms, encode mean "
+                  << encodeMs / framesCaptured << " ms per captured frame" << std::endl;
+    }
+}
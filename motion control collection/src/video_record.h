@@ -0,0 +1,28 @@
+#ifndef VIDEO_RECORD_H
+#define VIDEO_RECORD_H
+
+#include "common.h"
+#include <string>
+
+// Records the whole window (game area and camera panel) to a video file.
+// At the video frame rate the rendered frame is read back into the next free
+// buffer of a preallocated ring just before it is presented; a background
+// thread encodes filled buffers with cv::VideoWriter. When every buffer is
+// still waiting for the encoder the frame is dropped instead of blocking the
+// game, and the next one is written repeatedly to cover the gap so the video
+// keeps time. Replays and soak runs are timed by session time, so they record
+// at game speed however fast they run.
+const int VIDEO_RING_FRAMES = 8;
+const double VIDEO_DEFAULT_FPS = 30.0;
+
+// .avi files are written as MJPG, anything else as MPEG-4 Part 2.
+bool videoRecordStart(const std::string& path, SDL_Renderer* renderer, double fps);
+bool videoRecording();
+
+// Call once per loop iteration, after drawing and before presenting.
+void videoRecordFrame(SDL_Renderer* renderer);
+
+// Encodes what is still queued, closes the file and prints the frame counts.
+void videoRecordStop();
+
+#endif
@@ -0,0 +1,29 @@
+#include "beat_map.h"
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: analyze_beats AUDIO_FILE..." << std::endl;
+        return 1;
+    }
+    SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+    if (SDL_Init(SDL_INIT_AUDIO) < 0 || Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
+        std::cerr << "Could not open audio for decoding: " << SDL_GetError() << std::endl;
+        return 1;
+    }
+
+    int failed = 0;
+    for (int i = 1; i < argc; i++) {
+        BeatMap map;
+        if (!beatMapLoad(argv[i], map)) {
+            std::cerr << "Could not analyze " << argv[i] << std::endl;
+            failed++;
+            continue;
+        }
+        std::cout << argv[i] << ": " << map.tempo << " BPM, " << map.beats.size() << " beats over "
+                  << map.length << " s" << std::endl;
+    }
+
+    Mix_CloseAudio();
+    SDL_Quit();
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,54 @@
+#include "pose_model.h"
+#include "pose_int8.h"
+
+int main(int argc, char* argv[]) {
+    std::string input, outDir = POSE_INT8_CALIBRATION_DIR;
+    int frames = INT8_CALIBRATION_FRAMES;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) {
+            frames = std::max(INT8_VALIDATION_EVERY, std::atoi(argv[++i]));
+        } else if (arg == "--out" && i + 1 < argc) {
+            outDir = argv[++i];
+        } else if (input.empty() && arg[0] != '-') {
+            input = arg;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (input.empty()) {
+        std::cerr << "Usage: calibrate_pose VIDEO|IMAGE_DIR [--frames N] [--out DIR]" << std::endl;
+        return 1;
+    }
+
+    cv::dnn::Net net;
+    std::string weightsPath;
+    try {
+        if (!poseModelLoad(net, weightsPath)) {
+            std::cerr << "OpenPose model files not found" << std::endl;
+            return 1;
+        }
+    } catch (const cv::Exception& e) {
+        std::cerr << "Failed to load OpenPose: " << e.what() << std::endl;
+        return 1;
+    }
+    net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+    net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+
+    PoseCalibration calibration;
+    if (!poseCalibrationCollect(input, frames, net, calibration)) return 1;
+    if (!poseCalibrationSave(outDir, calibration)) {
+        std::cerr << "Could not write " << outDir << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << calibration.calibration.size() << " calibration and " << calibration.validation.size()
+              << " validation frames to " << outDir << std::endl;
+
+    // The game repeats this check at startup; running it here tells whether
+    // the recording is good enough before anyone relies on it.
+    WristAccuracy accuracy;
+    bool passed = poseQuantize(net, calibration, accuracy);
+    poseAccuracyPrint(accuracy);
+    return passed ? 0 : 2;
+}
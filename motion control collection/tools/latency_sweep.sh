@@ -0,0 +1,42 @@
+#!/bin/bash
+# Runs the motion-to-photon latency test for every game with each pose
+# backend and appends one JSON line per run to the results file.
+#
+# Usage: tools/latency_sweep.sh [synthetic|VIDEO] [RESULTS_FILE] [EVENTS]
+#
+# Set PIPELINE_DEPTHS (e.g. "2 4") to also measure the network backends with
+# pipelined inference at each depth.
+
+INPUT="${1:-synthetic}"
+RESULTS="${2:-latency.jsonl}"
+EVENTS="${3:-20}"
+BINARY="${MOTION_CONTROL:-./output/motion_control}"
+
+if [ ! -x "$BINARY" ]; then
+    echo "motion_control not found at $BINARY (run ./build.sh or set MOTION_CONTROL)"
+    exit 1
+fi
+
+# The INT8 network is only measured once calibrate_pose has been run.
+BACKENDS="motion openpose"
+if [ -f models/int8_calibration/reference.yml ]; then
+    BACKENDS="$BACKENDS int8"
+fi
+
+: > "$RESULTS"
+for backend in $BACKENDS; do
+    DEPTHS=1
+    if [ "$backend" != "motion" ]; then
+        DEPTHS="1 $PIPELINE_DEPTHS"
+    fi
+    for depth in $DEPTHS; do
+        for game in 1 2 3 4 5; do
+            echo "=== game $game, backend $backend, pipeline $depth ==="
+            "$BINARY" --latency-test "$INPUT" --latency-events "$EVENTS" \
+                --game "$game" --pose-backend "$backend" --pose-pipeline "$depth" --latency-out "$RESULTS"
+        done
+    done
+done
+
+echo ""
+echo "Results written to $RESULTS"
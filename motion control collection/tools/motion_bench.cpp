@@ -0,0 +1,436 @@
+#include "common.h"
+#include "capture_source.h"
+#include "pose_vocabulary.h"
+#include "frame_prep.h"
+#include "thread_config.h"
+#include "pose_int8.h"
+#include "particles.h"
+#include "pose_pipeline.h"
+#include <chrono>
+#include <functional>
+#include <string>
+
+struct BenchResult {
+    std::string name;
+    std::vector<double> samples;
+};
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    double pos = p * (sorted.size() - 1);
+    size_t lo = (size_t)pos;
+    size_t hi = std::min(lo + 1, sorted.size() - 1);
+    double frac = pos - lo;
+    return sorted[lo] * (1 - frac) + sorted[hi] * frac;
+}
+
+static BenchResult runBench(const std::string& name, int warmup, int iterations,
+                            const std::function<void(int)>& fn) {
+    for (int i = 0; i < warmup; i++) fn(i);
+
+    BenchResult result;
+    result.name = name;
+    result.samples.reserve(iterations);
+    for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        fn(i);
+        auto end = std::chrono::steady_clock::now();
+        result.samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::cerr << "  " << name << ": " << iterations << " iterations" << std::endl;
+    return result;
+}
+
+static void writeResults(std::ostream& out, const std::vector<BenchResult>& results,
+                         const std::string& format, const std::string& input) {
+    if (format == "csv") {
+        out << "name,samples,mean_ms,min_ms,p50_ms,p90_ms,p99_ms,max_ms\n";
+    } else {
+        out << "{\n  \"opencv\": \"" << CV_VERSION << "\",\n"
+            << "  \"threads\": " << cv::getNumThreads() << ",\n"
+            << "  \"input\": \"";
+        writeJsonEscaped(out, input);
+        out << "\",\n  \"results\": [\n";
+    }
+
+    for (size_t i = 0; i < results.size(); i++) {
+        std::vector<double> sorted = results[i].samples;
+        std::sort(sorted.begin(), sorted.end());
+        double mean = 0;
+        for (double s : sorted) mean += s;
+        mean /= std::max<size_t>(1, sorted.size());
+        double minMs = sorted.empty() ? 0 : sorted.front();
+        double maxMs = sorted.empty() ? 0 : sorted.back();
+
+        if (format == "csv") {
+            out << results[i].name << "," << sorted.size() << "," << mean << "," << minMs << ","
+                << percentile(sorted, 0.5) << "," << percentile(sorted, 0.9) << ","
+                << percentile(sorted, 0.99) << "," << maxMs << "\n";
+        } else {
+            out << "    {\"name\": \"" << results[i].name << "\", \"samples\": " << sorted.size()
+                << ", \"mean_ms\": " << mean << ", \"min_ms\": " << minMs
+                << ", \"p50_ms\": " << percentile(sorted, 0.5)
+                << ", \"p90_ms\": " << percentile(sorted, 0.9)
+                << ", \"p99_ms\": " << percentile(sorted, 0.99)
+                << ", \"max_ms\": " << maxMs << "}"
+                << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+    }
+
+    if (format != "csv") {
+        out << "  ]\n}\n";
+    }
+}
+
+static std::vector<cv::Mat> syntheticFrames() {
+    cv::setRNGSeed(42);
+    std::vector<cv::Mat> frames;
+    for (int i = 0; i < 2; i++) {
+        cv::Mat frame(480, 640, CV_8UC3);
+        cv::randu(frame, cv::Scalar(0, 0, 0), cv::Scalar(60, 60, 60));
+        cv::circle(frame, cv::Point(160 + i * 40, 200), 40, cv::Scalar(220, 200, 180), -1);
+        cv::circle(frame, cv::Point(480 - i * 40, 220), 40, cv::Scalar(220, 200, 180), -1);
+        frames.push_back(frame);
+    }
+    return frames;
+}
+
+static std::vector<cv::Mat> recordedFrames(const std::string& path, int maxFrames) {
+    CaptureSource source;
+    std::vector<cv::Mat> frames;
+    if (!source.openInput(path, false, false, 30.0)) return frames;
+    cv::Mat frame;
+    while ((int)frames.size() < maxFrames && source.read(frame)) {
+        frames.push_back(frame.clone());
+    }
+    return frames;
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = 200;
+    int netIterations = 20;
+    int warmup = 10;
+    std::string format = "json";
+    std::string outPath;
+    std::string inputPath;
+    std::string filter;
+    bool threadSweep = false;
+    int pipelineSweep = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) {
+            iterations = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--net-iterations" && i + 1 < argc) {
+            netIterations = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            warmup = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--format" && i + 1 < argc) {
+            format = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            outPath = argv[++i];
+        } else if (arg == "--input" && i + 1 < argc) {
+            inputPath = argv[++i];
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--thread-sweep") {
+            threadSweep = true;
+        } else if (arg == "--pipeline-sweep" && i + 1 < argc) {
+            pipelineSweep = std::max(1, std::min(POSE_PIPELINE_MAX_DEPTH, std::atoi(argv[++i])));
+        } else {
+            std::cerr << "Usage: motion_bench [--iterations N] [--net-iterations N] [--warmup N]\n"
+                      << "                    [--format json|csv] [--out FILE] [--input VIDEO_OR_DIR]\n"
+                      << "                    [--filter NAME] [--thread-sweep] [--pipeline-sweep MAX_DEPTH]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<cv::Mat> frames = inputPath.empty() ? syntheticFrames() : recordedFrames(inputPath, 64);
+    if (frames.empty()) {
+        std::cerr << "No input frames available." << std::endl;
+        return 1;
+    }
+    int numFrames = (int)frames.size();
+
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, WINDOW_WIDTH, GAME_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer* renderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+    if (!renderer) {
+        std::cerr << "Software renderer could not be created: " << SDL_GetError() << std::endl;
+        return 1;
+    }
+
+    auto enabled = [&](const std::string& name) {
+        return filter.empty() || name.find(filter) != std::string::npos;
+    };
+
+    std::vector<BenchResult> results;
+    std::cerr << "Running benchmarks on " << numFrames << " frame(s)..." << std::endl;
+
+    cv::Mat blob;
+    if (enabled("blobFromImage")) {
+        results.push_back(runBench("blobFromImage", warmup, iterations, [&](int i) {
+            blob = cv::dnn::blobFromImage(frames[i % numFrames], 1.0 / 255,
+                                          cv::Size(POSE_INPUT_SIZE, POSE_INPUT_SIZE),
+                                          cv::Scalar(0, 0, 0), false, false);
+        }));
+    }
+
+    if (enabled("framePrepare")) {
+        results.push_back(runBench("framePrepare", warmup, iterations, [&](int i) {
+            const cv::Mat& frame = frames[i % numFrames];
+            framePrepare(frame);
+            framePoseBlob(frame);
+            framePreview(frame);
+        }));
+    }
+
+    PoseDetector detector;
+    cv::Mat output;
+    std::vector<cv::Mat> blobs;
+    if (enabled("net.forward") && netIterations > 0 && detector.init()) {
+        for (const cv::Mat& frame : frames) {
+            blobs.push_back(framePoseBlob(frame).clone());
+        }
+        results.push_back(runBench("net.forward", std::min(warmup, 2), netIterations, [&](int i) {
+            detector.net.setInput(blobs[i % numFrames]);
+            output = detector.net.forward();
+        }));
+    }
+    // The INT8 network needs the calibration written by calibrate_pose and
+    // is only timed if it passes the same wrist check the game applies.
+    PoseCalibration calibration;
+    if (enabled("net.forward.int8") && netIterations > 0 && (detector.initialized || detector.init()) &&
+        poseCalibrationLoad(POSE_INT8_CALIBRATION_DIR, calibration)) {
+        if (blobs.empty()) {
+            for (const cv::Mat& frame : frames) blobs.push_back(framePoseBlob(frame).clone());
+        }
+        cv::dnn::Net int8 = detector.net;
+        WristAccuracy accuracy;
+        bool quantized = poseQuantize(int8, calibration, accuracy);
+        poseAccuracyPrint(accuracy);
+        if (quantized) {
+            results.push_back(runBench("net.forward.int8", std::min(warmup, 2), netIterations, [&](int i) {
+                int8.setInput(blobs[i % numFrames]);
+                output = int8.forward();
+            }));
+        }
+    }
+    // Every thread count on the cores left to the game loop, with and without
+    // a core reserved for audio. Without the model the workload is frame
+    // preparation and the motion fallback, which also run on OpenCV's pool.
+    if (threadSweep) {
+        if (!detector.initialized) detector.init();
+        if (blobs.empty()) {
+            for (const cv::Mat& frame : frames) blobs.push_back(framePoseBlob(frame).clone());
+        }
+        PoseDetector fallback;
+        std::vector<std::vector<int>> cores = threadConfigCores();
+        int sweepIterations = detector.initialized ? std::max(1, netIterations) : iterations;
+        ThreadConfig bestLatency, bestThroughput;
+        double bestP99 = 0, bestMean = 0;
+        std::cerr << "Sweeping thread configurations on " << cores.size() << " core(s)..." << std::endl;
+        for (int reserve = cores.size() > 1 ? 1 : 0; reserve >= 0; reserve--) {
+            for (int threads = 1; threads <= (int)cores.size() - reserve; threads++) {
+                ThreadConfig config;
+                config.inferenceThreads = threads;
+                config.audioCpu = reserve ? cores.back().front() : AUDIO_CPU_NONE;
+                config = threadConfigResolve(config);
+                threadConfigApply(config);
+
+                std::string name = "threads." + std::to_string(threads) + (reserve ? "+audio" : "");
+                BenchResult result = runBench(name, std::min(warmup, 2), sweepIterations, [&](int i) {
+                    if (detector.initialized) {
+                        detector.net.setInput(blobs[i % numFrames]);
+                        output = detector.net.forward();
+                    } else {
+                        cv::Mat& frame = frames[i % numFrames];
+                        framePrepare(frame);
+                        framePoseBlob(frame);
+                        fallback.motionFallbackBothHands(frame);
+                    }
+                });
+                std::vector<double> sorted = result.samples;
+                std::sort(sorted.begin(), sorted.end());
+                double mean = 0;
+                for (double v : sorted) mean += v;
+                mean /= sorted.size();
+                double p99 = percentile(sorted, 0.99);
+                std::cerr << "    " << threadConfigDescribe(config) << ": mean " << mean << " ms, p99 "
+                          << p99 << " ms, " << 1000.0 / mean << " fps" << std::endl;
+
+                // Fewer threads and a reserved audio core win unless clearly slower.
+                if (bestP99 == 0 || p99 < bestP99 * 0.95) {
+                    bestP99 = p99;
+                    bestLatency = config;
+                }
+                if (bestMean == 0 || mean < bestMean * 0.95) {
+                    bestMean = mean;
+                    bestThroughput = config;
+                }
+                results.push_back(result);
+            }
+        }
+        auto flags = [](const ThreadConfig& config) {
+            return "--inference-threads " + std::to_string(config.inferenceThreads) + " --audio-cpu " +
+                   (config.audioCpu >= 0 ? std::to_string(config.audioCpu) : std::string("none"));
+        };
+        std::cerr << "Best latency:    " << threadConfigDescribe(bestLatency) << " (p99 " << bestP99 << " ms)\n"
+                  << "                 motion_control " << flags(bestLatency) << "\n"
+                  << "Best throughput: " << threadConfigDescribe(bestThroughput) << " (" << 1000.0 / bestMean << " fps)\n"
+                  << "                 motion_control " << flags(bestThroughput) << std::endl;
+        threadConfigApply(threadConfigResolve(ThreadConfig()));
+    }
+
+    // Pipelined inference at every depth up to the given one, with the
+    // networks kept full: a sample is the time between two poses, so the
+    // mean is the inverse of the pose rate, and the submit-to-result latency
+    // shows what the extra frames in flight cost.
+    if (pipelineSweep > 0) {
+        if (!detector.initialized && !detector.init()) {
+            std::cerr << "The pipeline sweep needs the OpenPose model files." << std::endl;
+        } else {
+            if (blobs.empty()) {
+                for (const cv::Mat& frame : frames) blobs.push_back(framePoseBlob(frame).clone());
+            }
+            int bestDepth = 0;
+            double bestMean = 0, bestLatency = 0;
+            for (int depth = 1; depth <= pipelineSweep; depth++) {
+                if (!posePipelineStart(detector.net, depth, false)) break;
+                int submitted = 0, taken = 0;
+                double latencyMs = 0;
+                PoseResult pose;
+                std::string name = "pipeline." + std::to_string(depth);
+                BenchResult result = runBench(name, depth, std::max(depth, netIterations), [&](int) {
+                    while (posePipelineReserve()) posePipelineSubmit(blobs[submitted++ % numFrames], 0);
+                    posePipelineTake(pose, true);
+                    if (taken++ >= depth) latencyMs += pose.latencyMs;   // skip the warmup poses
+                });
+                posePipelineStop();
+                double mean = 0;
+                for (double v : result.samples) mean += v;
+                mean /= result.samples.size();
+                latencyMs /= result.samples.size();
+                std::cerr << "    " << depth << " network(s): " << 1000.0 / mean << " poses/s, latency mean "
+                          << latencyMs << " ms" << std::endl;
+                // A deeper pipeline only wins if it is clearly faster.
+                if (bestMean == 0 || mean < bestMean * 0.95) {
+                    bestDepth = depth;
+                    bestMean = mean;
+                    bestLatency = latencyMs;
+                }
+                results.push_back(result);
+            }
+            if (bestDepth > 0) {
+                std::cerr << "Best pipeline:   " << bestDepth << " network(s), " << 1000.0 / bestMean
+                          << " poses/s at " << bestLatency << " ms latency\n"
+                          << "                 motion_control --pose-pipeline " << bestDepth << std::endl;
+            }
+        }
+    }
+
+    if (output.empty()) {
+        int shape[] = {1, 57, 46, 46};
+        output.create(4, shape, CV_32F);
+        cv::randu(output, cv::Scalar(0), cv::Scalar(1));
+    }
+
+    if (enabled("findHeatmapPeak")) {
+        results.push_back(runBench("findHeatmapPeak", warmup, iterations, [&](int) {
+            cv::Point leftPeak, rightPeak;
+            double leftConf, rightConf;
+            findHeatmapPeak(output, 7, leftPeak, leftConf);
+            findHeatmapPeak(output, 4, rightPeak, rightConf);
+        }));
+    }
+
+    if (enabled("poseScore")) {
+        std::mt19937 gen(42);
+        std::uniform_real_distribution<float> coord(0.2f, 0.8f);
+        std::vector<PoseFeature> candidates(8);
+        for (PoseFeature& candidate : candidates) {
+            Keypoint keypoints[NUM_KEYPOINTS];
+            for (Keypoint& k : keypoints) k = {coord(gen), coord(gen), 1.0f};
+            poseFeatureFromKeypoints(keypoints, true, candidate);
+        }
+        std::vector<PoseFeature> observed(16);
+        std::vector<const PoseFeature*> target(16);
+        for (size_t i = 0; i < observed.size(); i++) {
+            observed[i] = candidates[(i / 4) % candidates.size()];
+            target[i] = &candidates[(i / 5) % candidates.size()];
+        }
+        // The live match against the target pose and the judgement of a pose
+        // boundary, as Rhythm Dance runs them.
+        results.push_back(runBench("poseScore", warmup, iterations, [&](int i) {
+            poseDistance(observed[i % observed.size()], *target[i % target.size()]);
+            poseSequenceDistance(observed, target, 5);
+        }));
+    }
+
+    if (enabled("poseClassify")) {
+        std::mt19937 gen(7);
+        std::uniform_real_distribution<float> coord(0.2f, 0.8f);
+        PoseVocabulary vocabulary;
+        for (int i = 0; i < 2000; i++) {
+            vocabulary.addHandsPose("BENCH", coord(gen), coord(gen), coord(gen), coord(gen));
+        }
+        vocabulary.buildIndex();
+        results.push_back(runBench("poseClassify", warmup, iterations, [&](int i) {
+            float similarity;
+            vocabulary.classify(vocabulary[(i * 37) % vocabulary.size()].torso, similarity);
+        }));
+    }
+
+    if (enabled("motionFallbackBothHands")) {
+        PoseDetector fallback;
+        results.push_back(runBench("motionFallbackBothHands", warmup, iterations, [&](int i) {
+            fallback.motionFallbackBothHands(frames[i % numFrames]);
+        }));
+    }
+
+    if (enabled("drawFilledCircle")) {
+        SDL_SetRenderDrawColor(renderer, BLUE.r, BLUE.g, BLUE.b, BLUE.a);
+        results.push_back(runBench("drawFilledCircle", warmup, iterations, [&](int i) {
+            drawFilledCircle(renderer, 100 + (i % 600), GAME_HEIGHT / 2, 25);
+        }));
+    }
+
+    if (enabled("drawText")) {
+        SDL_SetRenderDrawColor(renderer, WHITE.r, WHITE.g, WHITE.b, WHITE.a);
+        results.push_back(runBench("drawText", warmup, iterations, [&](int) {
+            drawText(renderer, "MOTION CONTROL COLLECTION", 50, 50, 16);
+        }));
+    }
+
+    if (enabled("drawCameraFeed")) {
+        results.push_back(runBench("drawCameraFeed", warmup, iterations, [&](int i) {
+            drawCameraFeed(renderer, frames[i % numFrames], true);
+        }));
+    }
+
+    if (enabled("particles")) {
+        ParticleSystem particles;
+        while (particles.count < ParticleSystem::MAX_PARTICLES) {
+            particles.burst(100.0f + particles.count % 600, GAME_HEIGHT / 2.0f, PARTICLES_COMBO, 3.0f);
+        }
+        // A tiny step barely ages the particles, so the pool stays full.
+        results.push_back(runBench("particles.update", warmup, iterations, [&](int) {
+            particles.update(0.0001f);
+        }));
+        results.push_back(runBench("particles.draw", warmup, iterations, [&](int) {
+            particles.draw(renderer);
+            SDL_RenderFlush(renderer);
+        }));
+    }
+
+    if (outPath.empty()) {
+        writeResults(std::cout, results, format, inputPath.empty() ? "synthetic" : inputPath);
+    } else {
+        std::ofstream out(outPath);
+        writeResults(out, results, format, inputPath.empty() ? "synthetic" : inputPath);
+        std::cerr << "Results written to " << outPath << std::endl;
+    }
+
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(surface);
+    return 0;
+}
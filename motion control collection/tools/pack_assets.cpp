@@ -0,0 +1,10 @@
+#include "asset_pack.h"
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: pack_assets OUTPUT.pack FILE..." << std::endl;
+        return 1;
+    }
+    std::vector<std::string> files(argv + 2, argv + argc);
+    return assetPackWrite(argv[1], files) ? 0 : 1;
+}
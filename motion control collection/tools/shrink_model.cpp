@@ -0,0 +1,48 @@
+#include "pose_model.h"
+#include "frame_prep.h"
+#include <sys/stat.h>
+
+static long fileSize(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (long)st.st_size : -1;
+}
+
+// Largest heatmap difference between the original and converted networks on
+// a synthetic frame, as a sanity check of the conversion.
+static double compareOutputs(const std::string& original, const std::string& converted) {
+    cv::Mat frame(CAM_HEIGHT, CAM_WIDTH, CV_8UC3);
+    cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+    const cv::Mat& blob = framePoseBlob(frame);
+
+    cv::Mat outputs[2];
+    const std::string weights[2] = {original, converted};
+    for (int i = 0; i < 2; i++) {
+        cv::dnn::Net net = cv::dnn::readNetFromCaffe(POSE_PROTO_FILE, weights[i]);
+        net.setInput(blob);
+        outputs[i] = net.forward().clone();
+    }
+    return cv::norm(outputs[0], outputs[1], cv::NORM_INF);
+}
+
+int main(int argc, char* argv[]) {
+    std::string weights = argc > 1 ? argv[1] : POSE_WEIGHTS_FILE;
+    std::string out = argc > 2 ? argv[2] : POSE_WEIGHTS_FP16_FILE;
+    if (argc > 3) {
+        std::cerr << "Usage: shrink_model [WEIGHTS.caffemodel [OUTPUT.caffemodel]]" << std::endl;
+        return 1;
+    }
+
+    if (!poseModelShrink(weights, out)) return 1;
+    std::cout << "Wrote " << out << ": " << fileSize(weights) / (1024 * 1024) << " MB -> "
+              << fileSize(out) / (1024 * 1024) << " MB" << std::endl;
+
+    if (fileSize(POSE_PROTO_FILE) > 0) {
+        try {
+            std::cout << "Max heatmap difference: " << compareOutputs(weights, out) << std::endl;
+        } catch (const cv::Exception& e) {
+            std::cerr << "Could not compare the models: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}